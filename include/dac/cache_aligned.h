@@ -0,0 +1,54 @@
+/**
+ * @file cache_aligned.h
+ * @brief Contains the CacheAlignedAllocator class header and implementation.
+ */
+
+#ifndef SPM_PROJECT_CACHE_ALIGNED_H
+#define SPM_PROJECT_CACHE_ALIGNED_H
+
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+
+#define CACHE_LINE_SIZE 64
+
+/**
+ * @class CacheAlignedAllocator
+ * @brief A standard allocator whose storage always starts at the beginning of a cache line.
+ *
+ * In C++14, the default allocator ignores alignments stricter than the one of std::max_align_t. Together with
+ * alignas(CACHE_LINE_SIZE), this allocator ensures that every element of a container lies on its own cache lines.
+ *
+ * @tparam T the type of the allocated objects
+ */
+template<typename T>
+class CacheAlignedAllocator {
+public:
+    using value_type = T; /** Type alias */
+
+    CacheAlignedAllocator() = default;
+
+    template<typename U>
+    CacheAlignedAllocator(const CacheAlignedAllocator<U> &) {}
+
+    T *allocate(std::size_t n) {
+        void *ptr = nullptr;
+
+        if (posix_memalign(&ptr, CACHE_LINE_SIZE, n*sizeof(T)) != 0)
+            throw std::bad_alloc();
+
+        return static_cast<T *>(ptr);
+    }
+
+    void deallocate(T *ptr, std::size_t) {
+        std::free(ptr);
+    }
+
+    template<typename U>
+    bool operator==(const CacheAlignedAllocator<U> &) const { return true; }
+
+    template<typename U>
+    bool operator!=(const CacheAlignedAllocator<U> &) const { return false; }
+};
+
+#endif //SPM_PROJECT_CACHE_ALIGNED_H
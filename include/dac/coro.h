@@ -0,0 +1,441 @@
+/**
+ * @file coro.h
+ * @brief Contains the Task class template, a C++20 coroutine front end of the Scheduler.
+ *
+ * This header requires a compiler supporting the C++20 coroutines (e.g., g++ 10 or later, with -std=c++20), otherwise
+ * it is empty. The rest of the library does not depend on it.
+ */
+
+#ifndef SPM_PROJECT_CORO_H
+#define SPM_PROJECT_CORO_H
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <coroutine>
+#include <atomic>
+#include <exception>
+#include <optional>
+#include <utility>
+#include "scheduler.h"
+#include "pool.h"
+
+template<typename T>
+class Task;
+
+template<typename T>
+class Child;
+
+template<typename T>
+T sync_wait(Pool &pool, Task<T> task, Scheduler::Policy policy = Scheduler::Policy::best);
+
+
+namespace detail {
+    // Recycles the coroutine frames of each thread, divided in size classes. A frame released by another thread (e.g.,
+    // the one completing it) is kept by that thread.
+    class FramePool {
+    private:
+        static constexpr std::size_t GRANULE = 64;  // Size classes are multiples of GRANULE
+        static constexpr std::size_t CLASSES = 16;  // Frames larger than GRANULE*(CLASSES - 1) are not recycled
+        static constexpr std::size_t MAX_FREE = 1024;  // Maximum number of free frames per class
+
+        struct Block {
+            Block *next;
+        };
+
+        Block *free_list[CLASSES] = {};
+        std::size_t free_count[CLASSES] = {};
+
+        static FramePool &local() {
+            thread_local FramePool pool;
+            return pool;
+        }
+
+    public:
+        ~FramePool() {
+            for (auto head: free_list) {
+                while (head != nullptr) {
+                    auto next = head->next;
+                    ::operator delete(head);
+                    head = next;
+                }
+            }
+        }
+
+        static void *allocate(std::size_t size) {
+            auto c = (size + GRANULE - 1)/GRANULE;
+
+            if (c >= CLASSES)
+                return ::operator new(size);
+
+            auto &pool = local();
+            auto block = pool.free_list[c];
+
+            if (block == nullptr)
+                return ::operator new(c*GRANULE);
+
+            pool.free_list[c] = block->next;
+            --pool.free_count[c];
+
+            return block;
+        }
+
+        static void deallocate(void *ptr, std::size_t size) {
+            auto c = (size + GRANULE - 1)/GRANULE;
+
+            if (c >= CLASSES) {
+                ::operator delete(ptr);
+                return;
+            }
+
+            auto &pool = local();
+
+            if (pool.free_count[c] == MAX_FREE) {
+                ::operator delete(ptr);
+                return;
+            }
+
+            auto block = static_cast<Block *>(ptr);
+            block->next = pool.free_list[c];
+            pool.free_list[c] = block;
+            ++pool.free_count[c];
+        }
+    };
+
+    // The scheduler running the tasks, and the ID of the current worker
+    struct CoroContext {
+        Scheduler *scheduler;
+        unsigned long worker;
+    };
+
+    inline thread_local CoroContext context = {nullptr, 0ul};
+
+    // A coroutine may be resumed by another thread: the address of the thread local context must not be cached across
+    // the suspension points, hence it is always retrieved through a call
+    [[gnu::noinline]] inline CoroContext &current_context() {
+        return context;
+    }
+
+    // Mark a completed task, or a task detached from its parent (@see Child), in place of its continuation
+    inline char done_marker, detached_marker;
+
+    struct PromiseBase {
+        // The coroutine to resume when the task completes (nullptr if not awaited yet, &done_marker once completed,
+        // &detached_marker if nobody will await it)
+        std::atomic<void *> continuation{nullptr};
+        std::exception_ptr error;
+
+        // Resumes the continuation, if the task has already been awaited, without growing the stack
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+
+            template<typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+                auto next = handle.promise().continuation.exchange(&done_marker, std::memory_order_acq_rel);
+
+                if (next == &detached_marker)
+                    handle.destroy();
+
+                if (next == nullptr || next == &detached_marker)
+                    return std::noop_coroutine();
+
+                return std::coroutine_handle<>::from_address(next);
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        static void *operator new(std::size_t size) {
+            return FramePool::allocate(size);
+        }
+
+        static void operator delete(void *ptr, std::size_t size) {
+            FramePool::deallocate(ptr, size);
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void unhandled_exception() {
+            error = std::current_exception();
+        }
+
+        bool done() const {
+            return continuation.load(std::memory_order_acquire) == &done_marker;
+        }
+
+        // Registers the awaiting coroutine, returns false if the task has already completed
+        bool await(std::coroutine_handle<> awaiting) {
+            void *expected = nullptr;
+
+            return continuation.compare_exchange_strong(expected, awaiting.address(), std::memory_order_acq_rel);
+        }
+
+        // Lets the task destroy itself once completed, returns false if it has already completed
+        bool detach() {
+            void *expected = nullptr;
+
+            return continuation.compare_exchange_strong(expected, &detached_marker, std::memory_order_acq_rel);
+        }
+    };
+
+    template<typename T>
+    struct Promise : PromiseBase {
+        std::optional<T> value;
+
+        Task<T> get_return_object();
+
+        template<typename U>
+        void return_value(U &&result) {
+            value.emplace(std::forward<U>(result));
+        }
+
+        T result() {
+            if (error)
+                std::rethrow_exception(error);
+
+            return std::move(*value);
+        }
+    };
+
+    template<>
+    struct Promise<void> : PromiseBase {
+        Task<void> get_return_object();
+
+        void return_void() {}
+
+        void result() {
+            if (error)
+                std::rethrow_exception(error);
+        }
+    };
+
+    // Awaits a task scheduled with spawn (@see Child)
+    template<typename T>
+    struct SpawnAwaiter {
+        Task<T> task;
+
+        bool await_ready() noexcept { return true; }
+
+        void await_suspend(std::coroutine_handle<>) noexcept {}
+
+        Child<T> await_resume();
+    };
+}
+
+/**
+ * @class Task
+ * @brief A divide and conquer computation written as a C++20 coroutine.
+ *
+ * A function returning Task<T> is a coroutine that produces a T (with co_return), and that may suspend waiting for
+ * other tasks instead of splitting its algorithm in divide, conquer, test and base case functions. A task does not
+ * start when it is called, but when it is either:
+ *     - awaited directly (co_await task): it is executed by the current worker, as a function call;
+ *     - spawned (co_await spawn(task)): it is scheduled as a new job of the Scheduler, on the current worker, so that
+ *     it may be balanced between the workers, and it is awaited later through the returned Child (@see spawn);
+ *     - passed to sync_wait, which computes it in parallel and returns its result.
+ *
+ * A task waiting for a child that has not completed yet is suspended, and its worker moves on to other jobs: the task
+ * is resumed by the worker completing the child, without scheduling a new job (symmetric transfer). Hence, no worker
+ * ever blocks. The coroutine frames are recycled by each worker (@see detail::FramePool). The exceptions thrown by a
+ * task are rethrown where it is awaited.
+ *
+ * @tparam T the type of the result (it may be void)
+ */
+template<typename T>
+class Task {
+public:
+    using promise_type = detail::Promise<T>; /** Type alias */
+
+    Task(Task &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+    Task &operator=(Task &&other) noexcept {
+        if (this != &other) {
+            if (handle)
+                handle.destroy();
+
+            handle = std::exchange(other.handle, nullptr);
+        }
+
+        return *this;
+    }
+
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    ~Task() {
+        if (handle)
+            handle.destroy();
+    }
+
+    /**
+     * Executes the task on the current worker, suspending the awaiting coroutine until it completes.
+     */
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() noexcept { return false; }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().await(awaiting);
+                return handle;
+            }
+
+            T await_resume() {
+                return handle.promise().result();
+            }
+        };
+
+        return Awaiter{handle};
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+    friend promise_type;
+    friend class Child<T>;
+    friend struct detail::SpawnAwaiter<T>;
+
+    template<typename U>
+    friend U sync_wait(Pool &pool, Task<U> task, Scheduler::Policy policy);
+};
+
+/**
+ * @class Child
+ * @brief A task scheduled by spawn, running concurrently with its parent.
+ *
+ * Awaiting it (co_await child) suspends the parent until the child has completed, and returns its result (or rethrows
+ * its exception). Each child can be awaited only once. A child destroyed without being awaited (e.g., because its
+ * parent has thrown an exception) is detached: it runs to completion anyway, and its result is discarded. Hence, the
+ * data it uses must outlive it (sync_wait always waits for every task, detached ones included).
+ *
+ * @tparam T the type of the result
+ */
+template<typename T>
+class Child {
+public:
+    Child(Child &&other) noexcept = default;
+    Child &operator=(Child &&other) noexcept = default;
+
+    ~Child() {
+        if (task.handle && task.handle.promise().detach())
+            task.handle = nullptr;  // It will destroy itself
+    }
+
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            std::coroutine_handle<detail::Promise<T>> handle;
+
+            bool await_ready() noexcept {
+                return handle.promise().done();
+            }
+
+            bool await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                return handle.promise().await(awaiting);
+            }
+
+            T await_resume() {
+                return handle.promise().result();
+            }
+        };
+
+        return Awaiter{task.handle};
+    }
+
+private:
+    Task<T> task;
+
+    explicit Child(Task<T> &&task) : task(std::move(task)) {}
+
+    friend struct detail::SpawnAwaiter<T>;
+};
+
+/**
+ * Schedules @p task as a new job on the current worker (@see Task). It must be called within a task, and awaited
+ * (co_await spawn(task)): this never suspends the caller, and returns the Child to be awaited for the result.
+ *
+ * @tparam T the type of the result of the task
+ * @param task the task to be executed
+ * @return an awaitable returning the Child
+ */
+template<typename T>
+detail::SpawnAwaiter<T> spawn(Task<T> &&task) {
+    return {std::move(task)};
+}
+
+/**
+ * Computes @p task in parallel over the workers of @p pool, returning only when it has completed.
+ *
+ * The pool may be resized while the task is running (@see Pool::resize): the workers added take part in the
+ * computation, the ones removed stop after their current job.
+ *
+ * @warning It must not be called by a task running on the same pool.
+ * @tparam T the type of the result of the task
+ * @param pool the workers that will execute the task (and the tasks it spawns)
+ * @param task the task to be computed
+ * @param policy the balancing policy of the scheduler (@see Scheduler::Policy)
+ * @throw any exception thrown by the task
+ * @return the result of the task
+ */
+template<typename T>
+T sync_wait(Pool &pool, Task<T> task, Scheduler::Policy policy) {
+    Scheduler scheduler(pool.size(), policy, pool.capacity());
+    auto handle = task.handle;
+
+    // The first worker is the only one surely running, even if the pool is resized
+    scheduler.schedule([handle](unsigned long) {
+        handle.resume();
+    }, 0ul);
+
+    pool.run([&](unsigned long id) {
+        auto &context = detail::current_context();
+        auto saved = context;
+        context = {&scheduler, id};
+
+        while (scheduler.compute_next(id));
+
+        context = saved;
+    }, [&](unsigned long workers) {
+        scheduler.resize(workers);
+    });
+
+    return handle.promise().result();
+}
+
+/**
+ * Computes @p task in parallel, on a new pool of @p workers threads (@see sync_wait(Pool &, Task<T>, Policy)).
+ */
+template<typename T>
+T sync_wait(Task<T> task, unsigned long workers = 1ul, Scheduler::Policy policy = Scheduler::Policy::best) {
+    Pool pool(workers);
+    return sync_wait(pool, std::move(task), policy);
+}
+
+
+template<typename T>
+Task<T> detail::Promise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> detail::Promise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+template<typename T>
+Child<T> detail::SpawnAwaiter<T>::await_resume() {
+    auto handle = task.handle;
+    auto &context = current_context();
+
+    context.scheduler->schedule([handle](unsigned long) {
+        handle.resume();
+    }, context.worker);
+
+    return Child<T>(std::move(task));
+}
+
+#endif
+
+#endif //SPM_PROJECT_CORO_H
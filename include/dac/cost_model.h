@@ -0,0 +1,106 @@
+/**
+ * @file cost_model.h
+ * @brief Contains the CostModel class header.
+ */
+
+#ifndef SPM_PROJECT_COST_MODEL_H
+#define SPM_PROJECT_COST_MODEL_H
+
+#include <chrono>
+#include <atomic>
+#include <vector>
+#include "cache_aligned.h"
+
+/**
+ * @class CostModel
+ * @brief Online estimate of the execution time of the tasks, divided by kind.
+ *
+ * Every worker samples the duration of one task out of a given period (for each kind), and keeps an exponentially
+ * weighted moving average of the samples on its own cache line. The estimates of a worker can be read cheaply by the
+ * worker itself, while the overall estimates are averaged over all the workers.
+ */
+class CostModel {
+public:
+    using Clock = std::chrono::steady_clock; /** Type alias */
+
+    static constexpr double EWMA_WEIGHT = 0.125;  // Weight of a new sample in the moving averages
+
+    /**
+     * @enum Kind
+     * @brief The kind of the task.
+     *
+     *     - "fork": the division of a problem in sub-problems;
+     *     - "leaf": the solution of a base case;
+     *     - "join": the combination of the results of the sub-problems.
+     */
+    enum class Kind { fork, leaf, join };
+
+    /**
+     * @struct Estimates
+     * @brief Estimated execution time (in nanoseconds) of the tasks of each kind, or 0 if it is not known yet.
+     */
+    struct Estimates {
+        double fork;
+        double leaf;
+        double join;
+    };
+
+    /**
+     * Creates a CostModel instance.
+     *
+     * @param n_workers the number of workers that will sample the tasks
+     * @param period the sampling period: a task every @p period of the same kind will be measured
+     */
+    explicit CostModel(unsigned long n_workers = 1ul, unsigned long period = 16ul);
+
+    /**
+     * Changes the number of workers, keeping the estimates collected so far.
+     *
+     * @param n_workers the new number of workers
+     */
+    void resize(unsigned long n_workers);
+
+    /**
+     * Tells whether the next task of the given kind should be measured. It should be called only by @p worker itself.
+     *
+     * @param kind the kind of the task
+     * @param worker the ID of the worker that will execute the task
+     * @return true once every @p period calls
+     */
+    bool sample(Kind kind, unsigned long worker);
+
+    /**
+     * Records the duration of a sampled task. It should be called only by @p worker itself.
+     *
+     * @param kind the kind of the task
+     * @param worker the ID of the worker that executed the task
+     * @param elapsed the duration of the task
+     */
+    void record(Kind kind, unsigned long worker, Clock::duration elapsed);
+
+    /**
+     * @param kind the kind of the task
+     * @param worker the ID of the worker
+     * @return the estimate of the given worker (in nanoseconds), or 0 if it has not sampled any task of this kind yet
+     */
+    double estimate(Kind kind, unsigned long worker) const;
+
+    /**
+     * @return the estimates averaged over all the workers that have sampled some task
+     */
+    Estimates estimates() const;
+
+private:
+    struct alignas(CACHE_LINE_SIZE) Slot {
+        unsigned long calls[3];
+        std::atomic<double> average[3];
+
+        Slot();
+        Slot(const Slot &other);
+    };
+
+    std::vector<Slot, CacheAlignedAllocator<Slot>> slots;
+    unsigned long period;
+};
+
+#endif //SPM_PROJECT_COST_MODEL_H
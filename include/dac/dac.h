@@ -9,14 +9,69 @@
 #define SPM_PROJECT_DAC_H
 
 #include <functional>
+#include <algorithm>
 #include <future>
 #include <atomic>
+#include <map>
+#include <exception>
+#include <chrono>
+#include <thread>
 #include "scheduler.h"
+#include "pool.h"
+#include "memo_table.h"
+#include "cost_model.h"
+
+/**
+ * @class Span
+ * @brief A non-owning view over a contiguous sequence of objects.
+ *
+ * @tparam T the type of the viewed objects
+ */
+template<typename T>
+class Span {
+private:
+    T *ptr;
+    std::size_t length;
+
+public:
+    Span(T *data, std::size_t size) : ptr(data), length(size) {}
+
+    T *begin() const { return ptr; }
+    T *end() const { return ptr + length; }
+    T *data() const { return ptr; }
+    std::size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+    T &operator[](std::size_t i) const { return ptr[i]; }
+};
 
 /**
  * @class DAC
  * @brief Framework for parallel Divide and Conquer computation.
  *
+ * By default, the result of every sub-problem is passed to its parent through a promise, and the "conquer" tasks are
+ * executed only after every "fork" task has been completed. In "output slot" mode (@see set_output_slots), instead,
+ * every node of the recursion tree preallocates the outputs of its children, which write their result directly in
+ * place; the last child to complete runs the conquer function of its parent, without any promise/future.
+ *
+ * Multiple independent inputs can be processed as a stream (@see compute_stream), in which case the recursion trees of
+ * different inputs share the same workers and overlap in time.
+ *
+ * If the recursion produces identical sub-problems in different branches, the results can be memoized
+ * (@see set_memoization): every sub-problem is then computed only once, and its duplicates wait for its result.
+ *
+ * The execution time of the divide, base case and conquer functions is sampled while computing (@see
+ * get_cost_estimates). With the "adaptive" policy (which must be chosen explicitly, the default one being "best"), these
+ * estimates are passed to the scheduler, so that the base cases that are cheaper than moving them through the global
+ * queue are never spilled.
+ *
+ * If any of the given functions throws an exception, the computation is cancelled: the pending tasks are drained
+ * without calling any other function (except for the ones already running), and the first exception thrown is
+ * rethrown by compute() (or compute_stream()) once every worker has stopped.
+ *
+ * The sub-problems are divided eagerly, hence the intermediate sub-problems and results of the whole recursion tree may
+ * be held at the same time. A budget on them can be set (@see set_budget): while it is exceeded, the workers stop
+ * spawning new parallel tasks, finishing the subtrees already started.
+ *
  * @tparam TypeIn the type of the input (to be divided)
  * @tparam TypeOut the type of the output (to be conquered)
  */
@@ -25,20 +80,120 @@ class DAC {
 private:
     using DivideFun = std::function<void(const TypeIn &, std::vector<TypeIn> &)>;
     using ConquerFun = std::function<void(std::vector<TypeOut> &, TypeOut &)>;
+    using SpanConquerFun = std::function<void(Span<TypeOut>, TypeOut &)>;
     using BaseTestFun = std::function<bool(const TypeIn &)>;
     using BaseCaseFun = std::function<void(const TypeIn &, TypeOut &)>;
+    using SourceFun = std::function<bool(TypeIn &)>;
+    using SinkFun = std::function<void(unsigned long, TypeOut &)>;
+    using HashFun = std::function<std::size_t(const TypeIn &)>;
+    using EqualFun = std::function<bool(const TypeIn &, const TypeIn &)>;
+    using SizeFun = std::function<std::size_t(const TypeOut &)>;
+
+    // A node of the recursion tree, used in output slot mode. It owns the inputs and the outputs of its children, and
+    // counts the children that have not yet written their output. The root of a streamed tree has no output: it owns
+    // the streamed input (as its only sub-problem) and its result, and it is identified by its position in the stream.
+    struct Node {
+        std::vector<TypeIn> sub_problems;
+        std::vector<TypeOut> sub_results;
+        std::atomic_ulong pending;
+        Node *parent;
+        TypeOut *output;
+        const TypeIn *input;
+        unsigned long index;
+
+        Node(Node *parent, TypeOut *output, const TypeIn *input, unsigned long index = 0ul)
+                : pending(0ul), parent(parent), output(output), input(input), index(index) {}
+    };
+
+    // A duplicate sub-problem waiting for the memoized result (@see set_memoization)
+    struct Waiter {
+        TypeOut *output;
+        Node *parent;
+    };
+
+    using MemoType = MemoTable<TypeIn, TypeOut, Waiter>;
+
+    // Whether a sub-problem is a base case, if it has already been tested
+    enum class Leaf : char { unknown, yes, no };
+
+    // The estimated cost of a sub-problem to be scheduled (0 if unknown), and the outcome of its base test
+    struct Estimate {
+        double cost;
+        Leaf leaf;
+    };
+
+    // Limits on the memory held by a computation (@see set_budget)
+    struct Budget {
+        unsigned long max_tasks;
+        std::size_t max_bytes;
+        SizeFun size;
+    };
+
+    // State of the stream being computed (@see compute_stream)
+    struct Stream {
+        const SourceFun &source;
+        const SinkFun &sink;
+        bool ordered, exhausted;
+        unsigned long next_in, next_out;
+        unsigned long limit, held;  // Inputs retrieved whose result has not been passed to the sink yet
+        std::map<unsigned long, TypeOut> completed;
+        std::mutex mtx;
+
+        Stream(const SourceFun &source, const SinkFun &sink, bool ordered, unsigned long limit)
+                : source(source), sink(sink), ordered(ordered), exhausted(false), next_in(0ul), next_out(0ul),
+                  limit(limit), held(0ul) {}
+    };
 
     const DivideFun &divide;
-    const ConquerFun &conquer;
+    const ConquerFun *conquer;
+    const SpanConquerFun *span_conquer;
     const BaseTestFun &base_test;
     const BaseCaseFun &base_case;
+    bool slots;
 
     Scheduler forks, joins;
-    std::mutex mtx;
+    Stream *stream;
+    std::unique_ptr<MemoType> memo;
+    std::unique_ptr<Budget> budget;
+    CostModel costs;
+    bool adaptive;
+    std::atomic_bool cancelled;
+    std::atomic_llong live_tasks, live_bytes, peak_tasks, peak_bytes;
+    std::exception_ptr failure;
+    std::mutex mtx, failure_mtx;
+
+    // Elasticity state (@see resize), protected by resize_mtx
+    Pool *running;
+    bool follow_quota;
+    std::chrono::milliseconds quota_period;
+    std::thread monitor;
+    std::condition_variable monitor_cv;
+    std::mutex resize_mtx;
 
     void run(unsigned long id);
-    void fork(const TypeIn &input, std::promise<TypeOut> &promise, unsigned long id);
-    void join(std::vector<std::promise<TypeOut>> *sub_promises, std::promise<TypeOut> &promise);
+    void fork(const TypeIn &input, std::promise<TypeOut> &promise, unsigned long id, Leaf leaf = Leaf::unknown);
+    void join(std::vector<std::promise<TypeOut>> *sub_promises, std::promise<TypeOut> &promise, unsigned long id);
+    void fork(const TypeIn &input, TypeOut *output, Node *parent, unsigned long id, Leaf leaf = Leaf::unknown);
+    void complete(Node *node, unsigned long id);
+    void feed(unsigned long id);
+    void finish(Node *root, unsigned long id);
+    void prepare(unsigned long workers, Scheduler::Policy policy);
+    void split(const TypeIn &input, std::vector<TypeIn> &sub_problems, unsigned long id);
+    void solve(const TypeIn &input, TypeOut &output, unsigned long id);
+    void merge(std::vector<TypeOut> &results, TypeOut &output, unsigned long id);
+    void solve_inline(const TypeIn &input, TypeOut &output, unsigned long id);
+    bool over_budget() const;
+    long long size_of(const TypeOut &result) const;
+    void track(std::atomic_llong &live, std::atomic_llong &peak, long long delta);
+    void estimate(const std::vector<TypeIn> &sub_problems, std::vector<Estimate> &estimates, unsigned long id);
+    bool lookup(const TypeIn &input, TypeOut *output, Node *parent, unsigned long id);
+    void publish(const TypeIn &input, const TypeOut &output, unsigned long id);
+    void fail(std::exception_ptr error);
+    std::exception_ptr get_failure();
+    void attach(Pool &pool);
+    void detach();
+    unsigned long resize_running(unsigned long workers);
+    void follow();
 
 public:
     /**
@@ -52,6 +207,150 @@ public:
     DAC(const DivideFun &divide, const ConquerFun &conquer,
         const BaseTestFun &base_test, const BaseCaseFun &base_case);
 
+    /**
+     * Creates a DAC instance whose conquer function receives a view over the results of the sub-problems. The
+     * instance is created in output slot mode.
+     *
+     * @param divide the divide function.
+     * @param conquer the conquer function.
+     * @param base_test the test function. It should return true if the input belongs to the base case, false otherwise.
+     * @param base_case the base case function.
+     */
+    DAC(const DivideFun &divide, const SpanConquerFun &conquer,
+        const BaseTestFun &base_test, const BaseCaseFun &base_case);
+
+    /**
+     * Enables or disables the output slot mode. In this mode, every child writes its result directly into the
+     * storage preallocated by its parent (and, at the root, into the output passed to compute()), and the conquer
+     * function is executed by the last child completed, as soon as every sibling is done.
+     *
+     * @param enable true to use the output slots, false to use promises and futures
+     */
+    void set_output_slots(bool enable);
+
+    /**
+     * Enables the memoization of the sub-problems. Before being divided (or solved, if it is a base case), every
+     * sub-problem is looked up in a concurrent hash map: if an equal sub-problem has already been solved, its result
+     * is copied; if it is still being solved, the sub-problem is suspended (without blocking the worker) until the
+     * result is available. The memoized results are discarded at the beginning of every computation.
+     *
+     * The memoization requires the output slot mode, that will be used regardless of set_output_slots(). Both TypeIn
+     * and TypeOut must be copyable.
+     *
+     * @param hash the hash function of the sub-problems
+     * @param equal the equality function of the sub-problems
+     * @param shards the number of independently locked partitions of the hash map
+     */
+    void set_memoization(const HashFun &hash, const EqualFun &equal = std::equal_to<TypeIn>(),
+                         std::size_t shards = 64);
+
+    /**
+     * Disables the memoization of the sub-problems (@see set_memoization).
+     */
+    void disable_memoization();
+
+    /**
+     * Returns the estimated execution time of the divide ("fork"), base case ("leaf"), and conquer ("join") functions,
+     * as sampled by the workers during the previous computations.
+     *
+     * @return the estimates (in nanoseconds), or 0 for the functions that have not been sampled yet
+     */
+    CostModel::Estimates get_cost_estimates() const;
+
+    /**
+     * @struct Usage
+     * @brief Memory held by a computation, as accounted by the budget (@see set_budget). It is not the memory
+     *     resident in the process: only the sub-problems are counted, and only the results are measured (by the given
+     *     size function).
+     */
+    struct Usage {
+        unsigned long tasks;  // Sub-problems divided but not yet conquered
+        std::size_t bytes;  // Size of the results not yet conquered (as measured by the size function)
+    };
+
+    /**
+     * Limits the memory held by the next computations, i.e., the number of sub-problems divided but not yet
+     * conquered, and the size of the results not yet conquered. The peak usage of every computation is tracked
+     * (@see get_peak_usage), even with no limits.
+     *
+     * In output slot mode (thus also with memoization, and for streams), while the budget is exceeded, the sub-problems
+     * of a divided problem are not spawned as parallel tasks: they are forked one after the other by the same worker,
+     * depth first, each one checking the budget again. Hence, the subtrees are conquered (and their memory released)
+     * as soon as possible, and new parallel tasks are spawned again as soon as the usage drops below the budget. The
+     * number of sub-problems may exceed the budget by at most the depth of the recursion tree per worker.
+     *
+     * With promises, instead, nothing is conquered before every sub-problem has been divided, so the usage cannot drop
+     * during the computation: while the budget is exceeded, a sub-problem that is not a base case is solved
+     * sequentially (depth first) by the worker that retrieved it. The output slot mode keeps more parallelism under a
+     * tight budget.
+     *
+     * The results held by the memoization table, and the ones held by the sequential solutions, are not accounted.
+     *
+     * @param max_tasks the maximum number of sub-problems divided but not yet conquered, or 0 for no limit
+     * @param size a function returning the size (in bytes) of a result. If empty, the size of the results is not
+     *     tracked.
+     * @param max_bytes the maximum size of the results not yet conquered, or 0 for no limit
+     */
+    void set_budget(unsigned long max_tasks, const SizeFun &size = SizeFun(), std::size_t max_bytes = 0);
+
+    /**
+     * Removes the budget, and stops tracking the memory usage (@see set_budget).
+     */
+    void disable_budget();
+
+    /**
+     * @return the peak usage accounted in the last computation (@see Usage), or zeros if no budget was set
+     *     (@see set_budget)
+     */
+    Usage get_peak_usage() const;
+
+    /**
+     * Records the decisions of the scheduler of the "fork" tasks in the next computations (each one overwrites the
+     * trace of the previous one). @see Scheduler::record
+     *
+     * @param trace the trace where the decisions will be recorded. It must outlive the recording.
+     */
+    void record(Trace &trace);
+
+    /**
+     * Replays the decisions recorded in @p trace in the next computations, that must be run with the same number of
+     * workers. @see Scheduler::replay
+     *
+     * @param trace the recorded trace. It must outlive the replay.
+     */
+    void replay(const Trace &trace);
+
+    /**
+     * Stops both recording and replaying.
+     */
+    void stop_tracing();
+
+    /**
+     * Changes the number of workers of the running computation, within the capacity of its pool (@see Pool). It may
+     * be called at any time, by any thread, and it is the same as resizing the pool. The workers removed move their
+     * pending sub-problems in the global queue, where the others (and the ones added later) retrieve them. The pool
+     * keeps the new size after the computation.
+     *
+     * @warning Without output slots, the workers removed still complete the conquers of the sub-problems they have
+     *     divided, as these wait for each other: hence, they leave the divide phase for good. If they are added back
+     *     before the end of the computation, they do not divide sub-problems again, but the balancing policy counts
+     *     them anyway, and moves more sub-problems in the global queue than needed.
+     *
+     * @param workers the new number of workers, that will be clamped between 1 and the capacity of the pool
+     * @return the new number of workers, or 0 if no computation is running
+     */
+    unsigned long resize(unsigned long workers);
+
+    /**
+     * Makes the next computations follow the CPU quota of the cgroup of the process (@see cpu_quota): while a
+     * computation is running, the quota is checked periodically, and the computation is resized accordingly (within
+     * the capacity of its pool). Hence, the pool should be created with enough capacity for the largest quota.
+     *
+     * @param enable true to follow the quota, false to stop following it
+     * @param period the time between two checks of the quota
+     */
+    void follow_cpu_quota(bool enable, std::chrono::milliseconds period = std::chrono::milliseconds(100));
+
     /**
      * Computes the solution for @p input and stores the result in @p output, using the functions passed to the
      * constructor.
@@ -61,93 +360,784 @@ public:
      * @param workers the number of threads to use to compute the solution (i.e., the parallelism degree)
      * @param fork_policy the balancing policy to use in the scheduler that manages the "fork" tasks
      *     (@see Scheduler::Policy)
+     * @throw any exception thrown by the divide, conquer, test or base case functions (in which case the content of
+     *     @p output is unspecified)
      */
     void compute(const TypeIn &input, TypeOut &output, unsigned long workers = 1,
                  Scheduler::Policy policy = Scheduler::Policy::best);
+
+    /**
+     * Computes the solution for @p input and stores the result in @p output, using the (persistent) threads of
+     * @p pool instead of spawning new ones.
+     *
+     * @param input the input to be processed
+     * @param output the computed result
+     * @param pool the workers used to compute the solution (its size is the parallelism degree)
+     * @param fork_policy the balancing policy to use in the scheduler that manages the "fork" tasks
+     *     (@see Scheduler::Policy)
+     * @throw any exception thrown by the divide, conquer, test or base case functions (in which case the content of
+     *     @p output is unspecified)
+     */
+    void compute(const TypeIn &input, TypeOut &output, Pool &pool,
+                 Scheduler::Policy policy = Scheduler::Policy::best);
+
+    /**
+     * Computes the solutions of a stream of independent inputs. The inputs are retrieved from @p source until it
+     * returns false, and every result is passed to @p sink together with the position of its input in the stream.
+     * At most 2*@p workers inputs are held at the same time, counting both the ones being processed and (if
+     * @p ordered) the results waiting for the ones of the previous inputs: as soon as a result is passed to @p sink,
+     * the worker that has run its last conquer retrieves the next input and starts dividing it, so that the divide
+     * phase of the new tree overlaps with the conquer phase of the others.
+     *
+     * Both @p source and @p sink are never called concurrently. The results are always computed in output slot mode.
+     *
+     * @param source the function retrieving the next input. It should return false if the stream is over.
+     * @param sink the function consuming a result, given its position in the stream
+     * @param workers the number of threads to use to compute the solutions (i.e., the parallelism degree)
+     * @param ordered if true, the results are passed to @p sink in the same order of their inputs, otherwise as soon
+     *     as they are computed
+     * @param fork_policy the balancing policy to use in the scheduler that manages the "fork" tasks
+     *     (@see Scheduler::Policy)
+     * @throw any exception thrown by the given functions. No more inputs are retrieved, and no more results are
+     *     passed to @p sink, after the first exception.
+     */
+    void compute_stream(const SourceFun &source, const SinkFun &sink, unsigned long workers = 1,
+                        bool ordered = true, Scheduler::Policy policy = Scheduler::Policy::best);
+
+    /**
+     * Computes the solutions of a stream of independent inputs (@see compute_stream), using the (persistent) threads
+     * of @p pool instead of spawning new ones.
+     *
+     * @param source the function retrieving the next input. It should return false if the stream is over.
+     * @param sink the function consuming a result, given its position in the stream
+     * @param pool the workers used to compute the solutions (its size is the parallelism degree)
+     * @param ordered if true, the results are passed to @p sink in the same order of their inputs, otherwise as soon
+     *     as they are computed
+     * @param fork_policy the balancing policy to use in the scheduler that manages the "fork" tasks
+     *     (@see Scheduler::Policy)
+     * @throw any exception thrown by the given functions. No more inputs are retrieved, and no more results are
+     *     passed to @p sink, after the first exception.
+     */
+    void compute_stream(const SourceFun &source, const SinkFun &sink, Pool &pool,
+                        bool ordered = true, Scheduler::Policy policy = Scheduler::Policy::best);
 };
 
 
 template<typename TypeIn, typename TypeOut>
 DAC<TypeIn, TypeOut>::DAC(const DAC::DivideFun &divide, const DAC::ConquerFun &conquer,
                           const DAC::BaseTestFun &base_test, const DAC::BaseCaseFun &base_case)
-        : divide(divide), conquer(conquer), base_test(base_test),
-          base_case(base_case), forks(0), joins(0) {}
+        : divide(divide), conquer(&conquer), span_conquer(nullptr), base_test(base_test),
+          base_case(base_case), slots(false), forks(0), joins(0), stream(nullptr), adaptive(false), cancelled(false),
+          live_tasks(0ll), live_bytes(0ll), peak_tasks(0ll), peak_bytes(0ll), running(nullptr), follow_quota(false),
+          quota_period(100) {}
+
+template<typename TypeIn, typename TypeOut>
+DAC<TypeIn, TypeOut>::DAC(const DAC::DivideFun &divide, const DAC::SpanConquerFun &conquer,
+                          const DAC::BaseTestFun &base_test, const DAC::BaseCaseFun &base_case)
+        : divide(divide), conquer(nullptr), span_conquer(&conquer), base_test(base_test),
+          base_case(base_case), slots(true), forks(0), joins(0), stream(nullptr), adaptive(false), cancelled(false),
+          live_tasks(0ll), live_bytes(0ll), peak_tasks(0ll), peak_bytes(0ll), running(nullptr), follow_quota(false),
+          quota_period(100) {}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::set_output_slots(bool enable) {
+    std::unique_lock<std::mutex> lock(mtx);
+    slots = enable;
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::set_memoization(const HashFun &hash, const EqualFun &equal, std::size_t shards) {
+    std::unique_lock<std::mutex> lock(mtx);
+    memo.reset(new MemoType(hash, equal, shards));
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::disable_memoization() {
+    std::unique_lock<std::mutex> lock(mtx);
+    memo.reset();
+}
+
+template<typename TypeIn, typename TypeOut>
+CostModel::Estimates DAC<TypeIn, TypeOut>::get_cost_estimates() const {
+    return costs.estimates();
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::set_budget(unsigned long max_tasks, const SizeFun &size, std::size_t max_bytes) {
+    std::unique_lock<std::mutex> lock(mtx);
+    budget.reset(new Budget{max_tasks, max_bytes, size});
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::disable_budget() {
+    std::unique_lock<std::mutex> lock(mtx);
+    budget.reset();
+}
+
+template<typename TypeIn, typename TypeOut>
+typename DAC<TypeIn, TypeOut>::Usage DAC<TypeIn, TypeOut>::get_peak_usage() const {
+    return {static_cast<unsigned long>(peak_tasks.load()), static_cast<std::size_t>(peak_bytes.load())};
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::record(Trace &trace) {
+    forks.record(trace);
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::replay(const Trace &trace) {
+    forks.replay(trace);
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::stop_tracing() {
+    forks.stop_tracing();
+}
+
+template<typename TypeIn, typename TypeOut>
+unsigned long DAC<TypeIn, TypeOut>::resize(unsigned long workers) {
+    std::unique_lock<std::mutex> lock(resize_mtx);
+
+    if (running == nullptr)
+        return 0ul;
+
+    return resize_running(workers);
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::follow_cpu_quota(bool enable, std::chrono::milliseconds period) {
+    std::unique_lock<std::mutex> lock(mtx);
+    follow_quota = enable;
+    quota_period = period;
+}
 
 template<typename TypeIn, typename TypeOut>
 void DAC<TypeIn, TypeOut>::compute(const TypeIn &input, TypeOut &output, unsigned long workers,
                                    Scheduler::Policy policy) {
+    Pool pool(workers);
+    compute(input, output, pool, policy);
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::compute(const TypeIn &input, TypeOut &output, Pool &pool, Scheduler::Policy policy) {
     std::unique_lock<std::mutex> lock(mtx);
+    auto workers = pool.size();
+
+    prepare(pool.capacity(), policy);
+
+    if (slots || memo) {
+        forks.reset(workers, policy, pool.capacity());
+
+        forks.schedule([&](unsigned long id) {
+            fork(input, &output, nullptr, id);
+        }, 0ul);
+
+        attach(pool);
+
+        pool.run([this](unsigned long id) {
+            while (forks.compute_next(id));
+        }, [this](unsigned long workers) {
+            forks.resize(workers);
+        });
+
+        detach();
+
+        if (failure)
+            std::rethrow_exception(failure);
+
+        return;
+    }
+
     std::promise<TypeOut> promise;
 
-    forks.reset(workers, policy);
-    joins.reset(workers, Scheduler::Policy::only_local);
+    // Every worker completes its own joins, even if removed (@see resize)
+    forks.reset(workers, policy, pool.capacity());
+    joins.reset(pool.capacity(), Scheduler::Policy::only_local);
 
     forks.schedule([&](unsigned long id) {
         fork(input, promise, id);
     }, 0ul);
 
-    std::vector<std::thread> threads;
-
-    for (auto id = 0ul; id < workers - 1ul; ++id)
-        threads.emplace_back(&DAC::run, this, id);
+    attach(pool);
 
-    run(workers - 1ul);
+    pool.run([this](unsigned long id) {
+        run(id);
+    }, [this](unsigned long workers) {
+        forks.resize(workers);
+    });
 
-    for (auto &thread: threads)
-        thread.join();
+    detach();
 
     output = std::move(promise.get_future().get());
 }
 
 template<typename TypeIn, typename TypeOut>
-void DAC<TypeIn, TypeOut>::fork(const TypeIn &input, std::promise<TypeOut> &promise, unsigned long id) {
-    if (base_test(input)) {
-        TypeOut output;
-        base_case(input, output);
-        promise.set_value(std::move(output));
+void DAC<TypeIn, TypeOut>::compute_stream(const SourceFun &source, const SinkFun &sink, unsigned long workers,
+                                          bool ordered, Scheduler::Policy policy) {
+    Pool pool(workers);
+    compute_stream(source, sink, pool, ordered, policy);
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::compute_stream(const SourceFun &source, const SinkFun &sink, Pool &pool,
+                                          bool ordered, Scheduler::Policy policy) {
+    std::unique_lock<std::mutex> lock(mtx);
+    auto workers = pool.size();
+    Stream state(source, sink, ordered, 2ul*workers);
+
+    prepare(pool.capacity(), policy);
+
+    stream = &state;
+    forks.reset(workers, policy, pool.capacity());
+
+    // All the inputs start from the first worker (the only one surely running, in case of resizing): the scheduler
+    // moves them to the others
+    feed(0ul);
+
+    attach(pool);
+
+    pool.run([this](unsigned long id) {
+        while (forks.compute_next(id));
+    }, [this](unsigned long workers) {
+        forks.resize(workers);
+    });
+
+    detach();
+
+    stream = nullptr;
+
+    if (failure)
+        std::rethrow_exception(failure);
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::feed(unsigned long id) {
+    // Retrieves new inputs until the limit is reached
+    while (true) {
+        Node *root;
+
+        {
+            std::unique_lock<std::mutex> lock(stream->mtx);
+
+            if (stream->exhausted || stream->held >= stream->limit || cancelled.load(std::memory_order_relaxed))
+                return;
+
+            root = new Node(nullptr, nullptr, nullptr, stream->next_in);
+            root->sub_problems.resize(1ul);
+
+            try {
+                stream->exhausted = !stream->source(root->sub_problems.front());
+            } catch (...) {
+                stream->exhausted = true;
+                fail(std::current_exception());
+            }
+
+            if (stream->exhausted) {
+                delete root;
+                return;
+            }
+
+            ++stream->next_in;
+            ++stream->held;
+        }
+
+        root->sub_results.resize(1ul);
+        root->pending.store(1ul, std::memory_order_relaxed);
+
+        forks.schedule([=](unsigned long id) {
+            fork(root->sub_problems.front(), &root->sub_results.front(), root, id);
+        }, id);
+    }
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::finish(Node *root, unsigned long id) {
+    try {
+        std::unique_lock<std::mutex> lock(stream->mtx);
+        auto &result = root->sub_results.front();
+
+        track(live_bytes, peak_bytes, -size_of(result));
+
+        if (cancelled.load(std::memory_order_relaxed)) {
+            --stream->held;  // Discard the result
+        } else if (!stream->ordered) {
+            --stream->held;
+            stream->sink(root->index, result);
+        } else if (root->index != stream->next_out) {
+            // The result is still held, until the previous ones are passed to the sink
+            stream->completed.emplace(root->index, std::move(result));
+        } else {
+            --stream->held;
+            stream->sink(stream->next_out++, result);
+
+            for (auto it = stream->completed.begin();
+                 it != stream->completed.end() && it->first == stream->next_out;
+                 it = stream->completed.erase(it)) {
+                --stream->held;
+                stream->sink(stream->next_out++, it->second);
+            }
+        }
+    } catch (...) {
+        fail(std::current_exception());
+    }
+
+    delete root;
+    feed(id);
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::fork(const TypeIn &input, std::promise<TypeOut> &promise, unsigned long id, Leaf leaf) {
+    // Drain the job if the computation has been cancelled
+    if (cancelled.load(std::memory_order_relaxed)) {
+        promise.set_exception(get_failure());
+        return;
+    }
+
+    std::vector<TypeIn> *sub_problems = nullptr;
+    std::vector<Estimate> estimates;
+
+    try {
+        // The base test may have already been called by the parent (@see estimate)
+        auto base = leaf == Leaf::unknown ? base_test(input) : leaf == Leaf::yes;
+
+        if (base || over_budget()) {
+            TypeOut output;
+
+            if (base)
+                solve(input, output, id);
+            else
+                solve_inline(input, output, id);
+
+            track(live_bytes, peak_bytes, size_of(output));
+            promise.set_value(std::move(output));
+
+            return;
+        }
+
+        sub_problems = new std::vector<TypeIn>();
+        split(input, *sub_problems, id);
+        estimate(*sub_problems, estimates, id);
+        track(live_tasks, peak_tasks, 1ll);
+    } catch (...) {
+        delete sub_problems;
+        fail(std::current_exception());
+        promise.set_exception(std::current_exception());
 
         return;
     }
 
-    auto sub_problems = new std::vector<TypeIn>();
-    divide(input, *sub_problems);
     auto size = sub_problems->size();
     auto sub_promises = new std::vector<std::promise<TypeOut>>(size);
     std::vector<Scheduler::JobType> sub_forks;
     sub_forks.reserve(size);
 
     for (auto i = 0ul; i < size; ++i) {
+        auto leaf = estimates[i].leaf;
+
         sub_forks.emplace_back([=](unsigned long id) {
-            fork((*sub_problems)[i], (*sub_promises)[i], id);
+            fork((*sub_problems)[i], (*sub_promises)[i], id, leaf);
         });
     }
 
-    joins.schedule(Scheduler::JobType([=, &promise](unsigned long ignored) {
-        join(sub_promises, promise);
+    joins.schedule(Scheduler::JobType([=, &promise](unsigned long id) {
+        join(sub_promises, promise, id);
 
         delete sub_problems;
     }), id);
 
+    // A problem divided in no sub-problems is conquered on no results
+    if (sub_forks.empty())
+        return;
+
     auto continuation = std::move(sub_forks.back());
     sub_forks.pop_back();
 
-    for (auto &&sf: sub_forks)
-        forks.schedule(std::move(sf), id);
+    for (auto i = 0ul; i < sub_forks.size(); ++i)
+        forks.schedule(std::move(sub_forks[i]), id, estimates[i].cost);
 
     continuation(id);
 }
 
 template<typename TypeIn, typename TypeOut>
-void DAC<TypeIn, TypeOut>::join(std::vector<std::promise<TypeOut>> *sub_promises, std::promise<TypeOut> &promise) {
+void DAC<TypeIn, TypeOut>::join(std::vector<std::promise<TypeOut>> *sub_promises, std::promise<TypeOut> &promise,
+                                unsigned long id) {
     std::vector<TypeOut> results;
-    std::transform(sub_promises->begin(), sub_promises->end(), std::back_inserter(results),
-                   [](std::promise<TypeOut> &p) { return p.get_future().get(); });
+    std::exception_ptr error;
 
-    TypeOut output;
-    conquer(results, output);
-    promise.set_value(std::move(output));
+    // Every future must be waited, even after an exception, before deleting the promises
+    for (auto &p: *sub_promises) {
+        try {
+            results.push_back(p.get_future().get());
+        } catch (...) {
+            if (!error)
+                error = std::current_exception();
+        }
+    }
 
     delete sub_promises;
+
+    if (!error && cancelled.load(std::memory_order_relaxed))
+        error = get_failure();
+
+    track(live_tasks, peak_tasks, -1ll);
+
+    if (!error) {
+        try {
+            auto bytes = 0ll;
+
+            for (auto &result: results)
+                bytes += size_of(result);
+
+            TypeOut output;
+            merge(results, output, id);
+
+            // The results are released only after the output has been built
+            track(live_bytes, peak_bytes, size_of(output));
+            track(live_bytes, peak_bytes, -bytes);
+            promise.set_value(std::move(output));
+
+            return;
+        } catch (...) {
+            error = std::current_exception();
+            fail(error);
+        }
+    }
+
+    promise.set_exception(error);
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::fork(const TypeIn &input, TypeOut *output, Node *parent, unsigned long id, Leaf leaf) {
+    // Drain the job if the computation has been cancelled
+    if (cancelled.load(std::memory_order_relaxed)) {
+        complete(parent, id);
+        return;
+    }
+
+    bool owner = false;  // Whether this call has to publish the memoized result
+    bool throttled = false;  // Whether the sub-problems cannot be spawned, as the budget is exceeded
+    Node *node = nullptr;
+    std::vector<Estimate> estimates;
+
+    try {
+        if (memo) {
+            if (!lookup(input, output, parent, id))
+                return;
+
+            owner = true;
+        }
+
+        // The base test may have already been called by the parent (@see estimate)
+        auto base = leaf == Leaf::unknown ? base_test(input) : leaf == Leaf::yes;
+
+        if (base) {
+            solve(input, *output, id);
+            track(live_bytes, peak_bytes, size_of(*output));
+        } else {
+            throttled = over_budget();
+            node = new Node(parent, output, &input);
+            split(input, node->sub_problems, id);
+            estimate(node->sub_problems, estimates, id);
+            track(live_tasks, peak_tasks, 1ll);
+        }
+    } catch (...) {
+        delete node;
+        node = nullptr;
+        fail(std::current_exception());
+    }
+
+    if (node == nullptr) {
+        if (owner)
+            publish(input, *output, id);
+
+        complete(parent, id);
+
+        return;
+    }
+
+    auto size = node->sub_problems.size();
+
+    // A problem divided in no sub-problems is conquered right away, on no results
+    if (size == 0ul) {
+        node->pending.store(1ul, std::memory_order_relaxed);
+        complete(node, id);
+
+        return;
+    }
+
+    node->sub_results.resize(size);
+    node->pending.store(size, std::memory_order_relaxed);
+
+    // Over budget, the sub-problems are forked one after the other by this worker, each one checking the budget again.
+    // The node cannot be completed (and deleted) before its last sub-problem is forked.
+    if (throttled) {
+        for (auto i = 0ul; i < size; ++i)
+            fork(node->sub_problems[i], &node->sub_results[i], node, id, estimates[i].leaf);
+
+        return;
+    }
+
+    for (auto i = 0ul; i < size - 1ul; ++i) {
+        auto leaf = estimates[i].leaf;
+
+        forks.schedule([=](unsigned long id) {
+            fork(node->sub_problems[i], &node->sub_results[i], node, id, leaf);
+        }, id, estimates[i].cost);
+    }
+
+    fork(node->sub_problems.back(), &node->sub_results.back(), node, id);
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::complete(Node *node, unsigned long id) {
+    // The last child to complete conquers its parent, and so on up to the root
+    while (node != nullptr && node->pending.fetch_sub(1ul, std::memory_order_acq_rel) == 1ul) {
+        if (node->output == nullptr) {
+            finish(node, id);
+            return;
+        }
+
+        try {
+            if (!cancelled.load(std::memory_order_relaxed)) {
+                auto bytes = 0ll;
+
+                for (auto &result: node->sub_results)
+                    bytes += size_of(result);
+
+                merge(node->sub_results, *node->output, id);
+
+                // The results are released only after the output has been built
+                track(live_bytes, peak_bytes, size_of(*node->output));
+                track(live_bytes, peak_bytes, -bytes);
+            }
+        } catch (...) {
+            fail(std::current_exception());
+        }
+
+        track(live_tasks, peak_tasks, -1ll);
+
+        if (memo)
+            publish(*node->input, *node->output, id);
+
+        auto parent = node->parent;
+        delete node;
+        node = parent;
+    }
+}
+
+template<typename TypeIn, typename TypeOut>
+bool DAC<TypeIn, TypeOut>::lookup(const TypeIn &input, TypeOut *output, Node *parent, unsigned long id) {
+    switch (memo->acquire(input, *output, Waiter{output, parent})) {
+        case MemoType::Lookup::ready:
+            complete(parent, id);
+            return false;
+
+        case MemoType::Lookup::in_flight:
+            return false;  // The sub-problem will be completed by publish()
+
+        default:
+            return true;
+    }
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::publish(const TypeIn &input, const TypeOut &output, unsigned long id) {
+    for (auto &waiter: memo->publish(input, output)) {
+        try {
+            if (!cancelled.load(std::memory_order_relaxed)) {
+                *waiter.output = output;
+                track(live_bytes, peak_bytes, size_of(output));
+            }
+        } catch (...) {
+            fail(std::current_exception());
+        }
+
+        complete(waiter.parent, id);
+    }
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::fail(std::exception_ptr error) {
+    std::unique_lock<std::mutex> lock(failure_mtx);
+
+    if (!failure)
+        failure = error;
+
+    cancelled.store(true, std::memory_order_relaxed);
+}
+
+template<typename TypeIn, typename TypeOut>
+std::exception_ptr DAC<TypeIn, TypeOut>::get_failure() {
+    std::unique_lock<std::mutex> lock(failure_mtx);
+    return failure;
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::prepare(unsigned long workers, Scheduler::Policy policy) {
+    if (memo)
+        memo->clear();
+
+    cancelled = false;
+    failure = nullptr;
+    live_tasks = 0ll;
+    live_bytes = 0ll;
+    peak_tasks = 0ll;
+    peak_bytes = 0ll;
+
+    costs.resize(workers);
+    adaptive = policy == Scheduler::Policy::adaptive;
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::split(const TypeIn &input, std::vector<TypeIn> &sub_problems, unsigned long id) {
+    if (!costs.sample(CostModel::Kind::fork, id)) {
+        divide(input, sub_problems);
+        return;
+    }
+
+    auto start = CostModel::Clock::now();
+    divide(input, sub_problems);
+    costs.record(CostModel::Kind::fork, id, CostModel::Clock::now() - start);
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::solve(const TypeIn &input, TypeOut &output, unsigned long id) {
+    if (!costs.sample(CostModel::Kind::leaf, id)) {
+        base_case(input, output);
+        return;
+    }
+
+    auto start = CostModel::Clock::now();
+    base_case(input, output);
+    costs.record(CostModel::Kind::leaf, id, CostModel::Clock::now() - start);
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::merge(std::vector<TypeOut> &results, TypeOut &output, unsigned long id) {
+    auto sampled = costs.sample(CostModel::Kind::join, id);
+    auto start = sampled ? CostModel::Clock::now() : CostModel::Clock::time_point();
+
+    if (span_conquer != nullptr)
+        (*span_conquer)(Span<TypeOut>(results.data(), results.size()), output);
+    else
+        (*conquer)(results, output);
+
+    if (sampled)
+        costs.record(CostModel::Kind::join, id, CostModel::Clock::now() - start);
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::solve_inline(const TypeIn &input, TypeOut &output, unsigned long id) {
+    // Stop as soon as possible if another worker has failed
+    if (cancelled.load(std::memory_order_relaxed))
+        return;
+
+    std::vector<TypeIn> sub_problems;
+    split(input, sub_problems, id);
+
+    std::vector<TypeOut> sub_results(sub_problems.size());
+
+    for (auto i = 0ul; i < sub_problems.size(); ++i) {
+        if (base_test(sub_problems[i]))
+            solve(sub_problems[i], sub_results[i], id);
+        else
+            solve_inline(sub_problems[i], sub_results[i], id);
+    }
+
+    merge(sub_results, output, id);
+}
+
+template<typename TypeIn, typename TypeOut>
+bool DAC<TypeIn, TypeOut>::over_budget() const {
+    if (!budget)
+        return false;
+
+    return (budget->max_tasks > 0ul && live_tasks.load(std::memory_order_relaxed) >= (long long) budget->max_tasks)
+           || (budget->max_bytes > 0ul && live_bytes.load(std::memory_order_relaxed) >= (long long) budget->max_bytes);
+}
+
+template<typename TypeIn, typename TypeOut>
+long long DAC<TypeIn, TypeOut>::size_of(const TypeOut &result) const {
+    return budget && budget->size ? budget->size(result) : 0ll;
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::track(std::atomic_llong &live, std::atomic_llong &peak, long long delta) {
+    if (!budget || delta == 0ll)
+        return;
+
+    auto value = live.fetch_add(delta, std::memory_order_relaxed) + delta;
+    auto last = peak.load(std::memory_order_relaxed);
+
+    while (value > last && !peak.compare_exchange_weak(last, value, std::memory_order_relaxed));
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::estimate(const std::vector<TypeIn> &sub_problems, std::vector<Estimate> &estimates,
+                                    unsigned long id) {
+    estimates.assign(sub_problems.size(), {0., Leaf::unknown});
+
+    if (!adaptive || sub_problems.empty())
+        return;
+
+    auto cost = costs.estimate(CostModel::Kind::leaf, id);
+
+    // Only the cost of the base cases can be estimated: the size of the sub-tree of the other sub-problems is unknown.
+    // The last sub-problem is never scheduled, as it is run by the current worker. The outcome of the base test is
+    // kept, so that the sub-problem is not tested again when it is forked.
+    for (auto i = 0ul; i < sub_problems.size() - 1ul; ++i) {
+        if (base_test(sub_problems[i]))
+            estimates[i] = {cost, Leaf::yes};
+        else
+            estimates[i] = {0., Leaf::no};
+    }
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::attach(Pool &pool) {
+    std::unique_lock<std::mutex> lock(resize_mtx);
+    running = &pool;
+
+    if (follow_quota)
+        monitor = std::thread(&DAC::follow, this);
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::detach() {
+    {
+        std::unique_lock<std::mutex> lock(resize_mtx);
+        running = nullptr;
+        monitor_cv.notify_all();
+    }
+
+    if (monitor.joinable())
+        monitor.join();
+}
+
+template<typename TypeIn, typename TypeOut>
+unsigned long DAC<TypeIn, TypeOut>::resize_running(unsigned long workers) {
+    // The pool resizes the scheduler first (@see compute): the workers added find themselves enabled, the ones removed
+    // stop by themselves
+    return running->resize(std::min(std::max(workers, 1ul), running->capacity()));
+}
+
+template<typename TypeIn, typename TypeOut>
+void DAC<TypeIn, TypeOut>::follow() {
+    std::unique_lock<std::mutex> lock(resize_mtx);
+
+    while (running != nullptr) {
+        lock.unlock();
+        auto quota = cpu_quota();
+        lock.lock();
+
+        if (running == nullptr)
+            break;
+
+        if (quota > 0ul && quota != running->size())
+            resize_running(quota);
+
+        monitor_cv.wait_for(lock, quota_period, [this]() { return running == nullptr; });
+    }
 }
 
 template<typename TypeIn, typename TypeOut>
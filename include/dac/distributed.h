@@ -0,0 +1,365 @@
+/**
+ * @file distributed.h
+ * @brief Contains the DistributedDAC class template, and the Channel and WorkerProcesses classes.
+ */
+
+#ifndef SPM_PROJECT_DISTRIBUTED_H
+#define SPM_PROJECT_DISTRIBUTED_H
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <deque>
+#include <sys/types.h>
+#include "dac.h"
+
+/**
+ * @class Channel
+ * @brief One end of a Unix domain socket, exchanging frames with the other end.
+ *
+ * Every frame has a type, a numeric ID and a payload of arbitrary bytes, and it is sent prefixed by its length.
+ */
+class Channel {
+public:
+    /**
+     * @enum Frame
+     * @brief The type of a frame.
+     */
+    enum class Frame : unsigned char { task, result, error, end };
+
+    /**
+     * Creates a Channel on a connected socket, taking its ownership.
+     *
+     * @param fd the file descriptor of the socket
+     */
+    explicit Channel(int fd = -1);
+
+    Channel(Channel &&other) noexcept;
+    Channel &operator=(Channel &&other) noexcept;
+    Channel(const Channel &) = delete;
+    Channel &operator=(const Channel &) = delete;
+
+    /**
+     * Closes the socket.
+     */
+    ~Channel();
+
+    /**
+     * Sends a frame.
+     *
+     * @throw std::runtime_error if the other end has been closed
+     * @param type the type of the frame
+     * @param id the ID of the frame
+     * @param payload the content of the frame
+     */
+    void send(Frame type, unsigned long long id, const std::string &payload = std::string());
+
+    /**
+     * Receives a frame, waiting for it.
+     *
+     * @throw std::runtime_error if the frame is truncated
+     * @param type the type of the received frame
+     * @param id the ID of the received frame
+     * @param payload the content of the received frame
+     * @return false if the other end has been closed
+     */
+    bool receive(Frame &type, unsigned long long &id, std::string &payload);
+
+    /**
+     * @return the file descriptor of the socket
+     */
+    int descriptor() const;
+
+    /**
+     * Closes the socket.
+     */
+    void close();
+
+private:
+    int fd;
+};
+
+/**
+ * @class WorkerProcesses
+ * @brief A set of child processes, each one connected to the parent by a Channel.
+ *
+ * The processes are created with fork(), so they share the code (and a copy of the memory) of the parent. They should
+ * be created before the parent starts other threads, as only the calling thread is copied in the children.
+ */
+class WorkerProcesses {
+public:
+    using BodyType = std::function<void(Channel &)>; /** Type alias */
+
+    /**
+     * Spawns the processes. Each one executes @p body on its end of the channel, and then exits.
+     *
+     * @throw std::runtime_error if the processes cannot be created
+     * @param n_processes the number of processes
+     * @param body the function executed by each process
+     */
+    WorkerProcesses(unsigned long n_processes, const BodyType &body);
+
+    WorkerProcesses(const WorkerProcesses &) = delete;
+    WorkerProcesses &operator=(const WorkerProcesses &) = delete;
+
+    /**
+     * Closes the channels, and waits for the processes to exit.
+     */
+    ~WorkerProcesses();
+
+    /**
+     * @param i the index of the process
+     * @return the channel connected to the process
+     */
+    Channel &operator[](unsigned long i);
+
+    /**
+     * @return the number of processes
+     */
+    unsigned long size() const;
+
+    /**
+     * Waits until a frame can be received from some process.
+     *
+     * @return the index of the process
+     */
+    unsigned long wait_any();
+
+private:
+    std::vector<Channel> channels;
+    std::vector<pid_t> pids;
+
+    void shutdown();
+};
+
+/**
+ * @class DistributedDAC
+ * @brief Divide and Conquer computation spread over multiple processes.
+ *
+ * The top of the recursion tree is divided by the calling process (the master), breadth first, until it has at least
+ * a given number of sub-problems per process (or only base cases). These sub-problems are serialized and sent to the
+ * worker processes over Unix domain sockets: every worker process computes them with its own DAC (and its own
+ * threads), and sends the serialized results back. The workers pull the sub-problems: each one receives a new
+ * sub-problem as soon as it returns a result, hence faster processes (or cheaper sub-problems) are balanced
+ * dynamically. Finally, the master conquers the top of the tree.
+ *
+ * The worker processes are created (with fork()) at every computation, and they exit at its end.
+ *
+ * @tparam TypeIn the type of the input (to be divided)
+ * @tparam TypeOut the type of the output (to be conquered)
+ */
+template<typename TypeIn, typename TypeOut>
+class DistributedDAC {
+private:
+    using DivideFun = std::function<void(const TypeIn &, std::vector<TypeIn> &)>;
+    using ConquerFun = std::function<void(std::vector<TypeOut> &, TypeOut &)>;
+    using BaseTestFun = std::function<bool(const TypeIn &)>;
+    using BaseCaseFun = std::function<void(const TypeIn &, TypeOut &)>;
+    using EncodeInFun = std::function<void(const TypeIn &, std::string &)>;
+    using DecodeInFun = std::function<void(const std::string &, TypeIn &)>;
+    using EncodeOutFun = std::function<void(const TypeOut &, std::string &)>;
+    using DecodeOutFun = std::function<void(const std::string &, TypeOut &)>;
+
+    // A node of the top of the recursion tree, divided by the master
+    struct Node {
+        TypeIn input;
+        std::vector<std::size_t> children;
+        bool sent;  // Whether it is computed by a worker process (otherwise, it has been divided by the master)
+    };
+
+    const DivideFun &divide;
+    const ConquerFun &conquer;
+    const BaseTestFun &base_test;
+    const BaseCaseFun &base_case;
+    const EncodeInFun &encode_in;
+    const DecodeInFun &decode_in;
+    const EncodeOutFun &encode_out;
+    const DecodeOutFun &decode_out;
+    unsigned long tasks_per_process;
+
+    void serve(Channel &channel, unsigned long workers, Scheduler::Policy policy);
+
+public:
+    /**
+     * Creates a DistributedDAC instance.
+     *
+     * @param divide the divide function, @see DAC
+     * @param conquer the conquer function, @see DAC
+     * @param base_test the base test function, @see DAC
+     * @param base_case the base case function, @see DAC
+     * @param encode_in the function serializing an input (appending its bytes to the given string)
+     * @param decode_in the function deserializing an input
+     * @param encode_out the function serializing a result (appending its bytes to the given string)
+     * @param decode_out the function deserializing a result
+     */
+    DistributedDAC(const DivideFun &divide, const ConquerFun &conquer, const BaseTestFun &base_test,
+                   const BaseCaseFun &base_case, const EncodeInFun &encode_in, const DecodeInFun &decode_in,
+                   const EncodeOutFun &encode_out, const DecodeOutFun &decode_out);
+
+    /**
+     * Sets the number of sub-problems that the master tries to create for each process. More sub-problems balance
+     * the processes better, but they are more expensive to send and to conquer.
+     *
+     * @param tasks the number of sub-problems per process (at least 1)
+     */
+    void set_tasks_per_process(unsigned long tasks);
+
+    /**
+     * Computes the solution for @p input and stores the result in @p output.
+     *
+     * @throw std::invalid_argument if @p processes is 0
+     * @throw std::runtime_error if a worker process fails (e.g., one of the given functions throws an exception in a
+     *     worker process, or the process dies)
+     * @param input the input to be processed
+     * @param output the computed result
+     * @param processes the number of worker processes
+     * @param workers the number of threads of each worker process
+     * @param policy the balancing policy of the schedulers of the worker processes (@see Scheduler::Policy)
+     */
+    void compute(const TypeIn &input, TypeOut &output, unsigned long processes, unsigned long workers = 1,
+                 Scheduler::Policy policy = Scheduler::Policy::best);
+};
+
+
+template<typename TypeIn, typename TypeOut>
+DistributedDAC<TypeIn, TypeOut>::DistributedDAC(const DivideFun &divide, const ConquerFun &conquer,
+                                                const BaseTestFun &base_test, const BaseCaseFun &base_case,
+                                                const EncodeInFun &encode_in, const DecodeInFun &decode_in,
+                                                const EncodeOutFun &encode_out, const DecodeOutFun &decode_out)
+        : divide(divide), conquer(conquer), base_test(base_test), base_case(base_case), encode_in(encode_in),
+          decode_in(decode_in), encode_out(encode_out), decode_out(decode_out), tasks_per_process(4ul) {}
+
+template<typename TypeIn, typename TypeOut>
+void DistributedDAC<TypeIn, TypeOut>::set_tasks_per_process(unsigned long tasks) {
+    tasks_per_process = std::max(tasks, 1ul);
+}
+
+template<typename TypeIn, typename TypeOut>
+void DistributedDAC<TypeIn, TypeOut>::compute(const TypeIn &input, TypeOut &output, unsigned long processes,
+                                              unsigned long workers, Scheduler::Policy policy) {
+    if (processes == 0ul)
+        throw std::invalid_argument("DistributedDAC: at least one worker process is needed");
+
+    // Divide the top of the tree breadth first: the children of a node always follow it
+    std::vector<Node> nodes;
+    std::deque<std::size_t> frontier;
+    std::vector<std::size_t> tasks;
+    std::vector<TypeIn> sub_problems;
+
+    nodes.push_back({input, {}, false});
+    frontier.push_back(0ul);
+
+    while (!frontier.empty() && frontier.size() + tasks.size() < tasks_per_process*processes) {
+        auto index = frontier.front();
+        frontier.pop_front();
+
+        if (base_test(nodes[index].input)) {
+            nodes[index].sent = true;
+            tasks.push_back(index);
+            continue;
+        }
+
+        sub_problems.clear();
+        divide(nodes[index].input, sub_problems);
+
+        for (auto &sub_problem: sub_problems) {
+            nodes[index].children.push_back(nodes.size());
+            frontier.push_back(nodes.size());
+            nodes.push_back({std::move(sub_problem), {}, false});
+        }
+    }
+
+    for (auto index: frontier) {
+        nodes[index].sent = true;
+        tasks.push_back(index);
+    }
+
+    // Send a task to every process, and a new one every time it returns a result
+    std::vector<TypeOut> results(nodes.size());
+
+    {
+        WorkerProcesses group(std::min(processes, static_cast<unsigned long>(tasks.size())), [&](Channel &channel) {
+            serve(channel, workers, policy);
+        });
+
+        auto next = 0ul, pending = 0ul;
+        std::string payload;
+
+        for (auto p = 0ul; p < group.size(); ++p, ++next, ++pending) {
+            payload.clear();
+            encode_in(nodes[tasks[next]].input, payload);
+            group[p].send(Channel::Frame::task, tasks[next], payload);
+        }
+
+        while (pending > 0ul) {
+            auto p = group.wait_any();
+            Channel::Frame type;
+            unsigned long long id;
+
+            if (!group[p].receive(type, id, payload))
+                throw std::runtime_error("DistributedDAC: a worker process has died");
+
+            if (type == Channel::Frame::error)
+                throw std::runtime_error("DistributedDAC: " + payload);
+
+            decode_out(payload, results[id]);
+            --pending;
+
+            if (next < tasks.size()) {
+                payload.clear();
+                encode_in(nodes[tasks[next]].input, payload);
+                group[p].send(Channel::Frame::task, tasks[next++], payload);
+                ++pending;
+            }
+        }
+
+        for (auto p = 0ul; p < group.size(); ++p)
+            group[p].send(Channel::Frame::end, 0ull);
+    }
+
+    // Conquer the top of the tree, from the bottom (including the nodes divided in no sub-problems, as DAC does)
+    std::vector<TypeOut> sub_results;
+
+    for (auto index = nodes.size(); index-- > 0ul;) {
+        if (nodes[index].sent)
+            continue;
+
+        sub_results.clear();
+
+        for (auto child: nodes[index].children)
+            sub_results.push_back(std::move(results[child]));
+
+        conquer(sub_results, results[index]);
+    }
+
+    output = std::move(results.front());
+}
+
+template<typename TypeIn, typename TypeOut>
+void DistributedDAC<TypeIn, TypeOut>::serve(Channel &channel, unsigned long workers, Scheduler::Policy policy) {
+    DAC<TypeIn, TypeOut> dac(divide, conquer, base_test, base_case);
+    Pool pool(workers);
+    Channel::Frame type;
+    unsigned long long id;
+    std::string payload;
+
+    while (channel.receive(type, id, payload) && type == Channel::Frame::task) {
+        try {
+            TypeIn input;
+            TypeOut output;
+
+            decode_in(payload, input);
+            dac.compute(input, output, pool, policy);
+
+            payload.clear();
+            encode_out(output, payload);
+            channel.send(Channel::Frame::result, id, payload);
+        } catch (std::exception &e) {
+            channel.send(Channel::Frame::error, id, e.what());
+        }
+    }
+}
+
+#endif //SPM_PROJECT_DISTRIBUTED_H
@@ -0,0 +1,159 @@
+/**
+ * @file memo_table.h
+ * @brief Contains the MemoTable class header and implementation.
+ */
+
+#ifndef SPM_PROJECT_MEMO_TABLE_H
+#define SPM_PROJECT_MEMO_TABLE_H
+
+#include <functional>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+/**
+ * @class MemoTable
+ * @brief A concurrent hash map of the results of the already computed (or being computed) sub-problems.
+ *
+ * The table is split in shards, each one protected by its own mutex, so that concurrent accesses to different keys
+ * rarely contend. Every key is either "in flight" (its result is being computed by someone) or "ready". Who looks up
+ * an in-flight key leaves a waiter, that will be returned to the thread that eventually publishes the result.
+ *
+ * @tparam Key the type of the sub-problems
+ * @tparam Value the type of their results
+ * @tparam Waiter the type of the objects waiting for an in-flight result
+ */
+template<typename Key, typename Value, typename Waiter>
+class MemoTable {
+public:
+    using HashFun = std::function<std::size_t(const Key &)>; /** Type alias */
+    using EqualFun = std::function<bool(const Key &, const Key &)>; /** Type alias */
+
+    /**
+     * @enum Lookup
+     * @brief Outcome of an acquire() call.
+     *
+     *     - "ready": the result was already computed;
+     *     - "in_flight": the result is being computed by someone else, the waiter has been stored;
+     *     - "missing": the key was not present, the caller is now in charge of computing and publishing the result.
+     */
+    enum class Lookup { ready, in_flight, missing };
+
+    /**
+     * Creates a MemoTable instance.
+     *
+     * @param hash the hash function of the keys
+     * @param equal the equality function of the keys
+     * @param n_shards the number of independent shards (at least 1)
+     */
+    MemoTable(const HashFun &hash, const EqualFun &equal, std::size_t n_shards = 64);
+
+    /**
+     * Looks up @p key. If its result is ready, it is copied into @p value; if it is in flight, @p waiter is stored
+     * and will be returned by the publish() call of the same key; otherwise, the key is marked as in flight.
+     *
+     * @param key the sub-problem to be looked up
+     * @param value where to copy the result, if ready
+     * @param waiter the object to be stored, if the result is in flight
+     * @return the outcome of the lookup
+     */
+    Lookup acquire(const Key &key, Value &value, const Waiter &waiter);
+
+    /**
+     * Stores the result of an in-flight key, marking it as ready.
+     *
+     * @param key the computed sub-problem
+     * @param value its result
+     * @return the waiters stored while the key was in flight
+     */
+    std::vector<Waiter> publish(const Key &key, const Value &value);
+
+    /**
+     * Erases every key in the table.
+     */
+    void clear();
+
+private:
+    struct Entry {
+        bool ready;
+        Value value;
+        std::vector<Waiter> waiters;
+
+        Entry() : ready(false), value() {}
+    };
+
+    struct Shard {
+        std::mutex mtx;
+        std::unordered_map<Key, Entry, HashFun, EqualFun> map;
+
+        Shard(const HashFun &hash, const EqualFun &equal) : map(16, hash, equal) {}
+    };
+
+    HashFun hash;
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    Shard &shard_of(const Key &key);
+};
+
+
+template<typename Key, typename Value, typename Waiter>
+MemoTable<Key, Value, Waiter>::MemoTable(const HashFun &hash, const EqualFun &equal, std::size_t n_shards)
+        : hash(hash) {
+    for (auto i = 0ul; i < std::max(n_shards, static_cast<std::size_t>(1)); ++i)
+        shards.emplace_back(new Shard(hash, equal));
+}
+
+template<typename Key, typename Value, typename Waiter>
+typename MemoTable<Key, Value, Waiter>::Lookup
+MemoTable<Key, Value, Waiter>::acquire(const Key &key, Value &value, const Waiter &waiter) {
+    auto &shard = shard_of(key);
+    std::unique_lock<std::mutex> lock(shard.mtx);
+    auto result = shard.map.emplace(key, Entry());
+    auto &entry = result.first->second;
+
+    if (result.second)
+        return Lookup::missing;
+
+    if (entry.ready) {
+        value = entry.value;
+        return Lookup::ready;
+    }
+
+    entry.waiters.push_back(waiter);
+    return Lookup::in_flight;
+}
+
+template<typename Key, typename Value, typename Waiter>
+std::vector<Waiter> MemoTable<Key, Value, Waiter>::publish(const Key &key, const Value &value) {
+    auto &shard = shard_of(key);
+    std::unique_lock<std::mutex> lock(shard.mtx);
+    auto &entry = shard.map.at(key);
+
+    entry.ready = true;
+    entry.value = value;
+
+    return std::move(entry.waiters);
+}
+
+template<typename Key, typename Value, typename Waiter>
+void MemoTable<Key, Value, Waiter>::clear() {
+    for (auto &shard: shards) {
+        std::unique_lock<std::mutex> lock(shard->mtx);
+        shard->map.clear();
+    }
+}
+
+template<typename Key, typename Value, typename Waiter>
+typename MemoTable<Key, Value, Waiter>::Shard &MemoTable<Key, Value, Waiter>::shard_of(const Key &key) {
+    auto h = hash(key);
+
+    // Mix the bits, so that the shard does not depend on the same bits used to pick the bucket
+    h ^= h >> 17u;
+    h *= 0x9e3779b97f4a7c15ull;
+
+    return *shards[(h >> 32u) % shards.size()];
+}
+
+#endif //SPM_PROJECT_MEMO_TABLE_H
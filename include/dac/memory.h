@@ -0,0 +1,110 @@
+/**
+ * @file memory.h
+ * @brief Contains the huge page allocation and first-touch placement helpers.
+ */
+
+#ifndef SPM_PROJECT_MEMORY_H
+#define SPM_PROJECT_MEMORY_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include "parallel_for.h"
+
+#define HUGE_PAGE_SIZE (2ul << 20)
+
+/**
+ * Allocates a buffer backed, if possible, by huge pages, so that a large array needs fewer TLB entries. The buffer is
+ * aligned to HUGE_PAGE_SIZE, and it is neither initialized nor touched: on NUMA machines, every page will be placed on
+ * the memory node of the thread that writes it first (@see first_touch).
+ *
+ * By default, the transparent huge pages are requested (with madvise), which the kernel may or may not grant. The
+ * explicit huge pages (MAP_HUGETLB) are always granted, but they must have been reserved by the administrator: if they
+ * are not available, the transparent ones are requested instead.
+ *
+ * @throw std::bad_alloc if the memory cannot be allocated
+ * @param bytes the size of the buffer
+ * @param explicit_pages true to try the explicit huge pages first
+ * @return the beginning of the buffer, to be released with huge_free
+ */
+void *huge_alloc(std::size_t bytes, bool explicit_pages = false);
+
+/**
+ * Releases a buffer allocated by huge_alloc.
+ *
+ * @param ptr the beginning of the buffer
+ * @param bytes the size passed to huge_alloc
+ */
+void huge_free(void *ptr, std::size_t bytes);
+
+/**
+ * Writes the elements of the range [@p first, @p last) in parallel over the workers of @p pool, so that each page is
+ * placed on the memory node of the worker that will later process it.
+ *
+ * The range is recursively bisected down to chunks of at most @p grain elements, as done by a DAC computation whose
+ * divide function splits a range in two halves (the left one first) and whose base test holds for at most the same
+ * cut-off: as DAC::compute, the current worker schedules the left half and keeps the right one (unlike parallel_for,
+ * which keeps the left half). Hence, if the computation runs on the same pool, its leaves will mostly be solved by the
+ * worker that has written them, and will find their data on its local memory node. The mapping is only statistical,
+ * as both computations are balanced dynamically, and it holds as long as the threads are not moved between nodes
+ * (e.g., pinned).
+ *
+ * @tparam Iterator a random access iterator (or a pointer)
+ * @tparam Init a callable with signature void(Iterator begin, Iterator end), which writes every element of the chunk
+ * @param pool the workers that will write the range (the same that will compute on it)
+ * @param first the first element of the range
+ * @param last the element past the last one of the range
+ * @param init the function writing the elements
+ * @param grain the maximum number of elements of a chunk, e.g. the cut-off of the base cases
+ * @throw any exception thrown by @p init
+ */
+template<typename Iterator, typename Init>
+void first_touch(Pool &pool, Iterator first, Iterator last, const Init &init, std::size_t grain) {
+    detail::run_range(pool, first, last, init, grain, Scheduler::Policy::best, false);
+}
+
+/**
+ * @class HugePageAllocator
+ * @brief A standard allocator whose storage is backed by huge pages (@see huge_alloc).
+ *
+ * The elements constructed without arguments are default-initialized (i.e., left uninitialized if they are of a
+ * trivial type), so that a container can be sized without touching its pages, and then initialized with first_touch.
+ *
+ * @tparam T the type of the allocated objects
+ */
+template<typename T>
+class HugePageAllocator {
+public:
+    using value_type = T; /** Type alias */
+
+    HugePageAllocator() = default;
+
+    template<typename U>
+    HugePageAllocator(const HugePageAllocator<U> &) {}
+
+    T *allocate(std::size_t n) {
+        return static_cast<T *>(huge_alloc(n*sizeof(T)));
+    }
+
+    void deallocate(T *ptr, std::size_t n) {
+        huge_free(ptr, n*sizeof(T));
+    }
+
+    template<typename U>
+    void construct(U *ptr) {
+        ::new(static_cast<void *>(ptr)) U;
+    }
+
+    template<typename U, typename... Args>
+    void construct(U *ptr, Args &&... args) {
+        ::new(static_cast<void *>(ptr)) U(std::forward<Args>(args)...);
+    }
+
+    template<typename U>
+    bool operator==(const HugePageAllocator<U> &) const { return true; }
+
+    template<typename U>
+    bool operator!=(const HugePageAllocator<U> &) const { return false; }
+};
+
+#endif //SPM_PROJECT_MEMORY_H
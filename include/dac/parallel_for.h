@@ -0,0 +1,128 @@
+/**
+ * @file parallel_for.h
+ * @brief Contains the parallel_for function template.
+ */
+
+#ifndef SPM_PROJECT_PARALLEL_FOR_H
+#define SPM_PROJECT_PARALLEL_FOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include "scheduler.h"
+#include "pool.h"
+
+/**
+ * Applies @p body to every index in the range [@p first, @p last), in parallel over the workers of @p pool.
+ *
+ * The range is recursively bisected: at every step, the right half is scheduled as a new job (thus balanced by the
+ * Scheduler using the given policy), while the left half is split again by the current worker. When a range has at
+ * most @p grain elements, @p body is called once on the whole (contiguous) chunk.
+ *
+ * If @p body throws an exception, the loop is cancelled: the chunks not yet started are skipped, and the first
+ * exception thrown is rethrown once every worker has stopped.
+ *
+ * The pool may be resized while the loop is running (@see Pool::resize): the workers added take part in the loop, the
+ * ones removed stop after their current chunk.
+ *
+ * @tparam Index an integral type (or a random access iterator)
+ * @tparam Body a callable with signature void(Index begin, Index end)
+ * @param pool the workers that will execute the loop
+ * @param first the first index of the range
+ * @param last the index past the last one of the range
+ * @param body the function to be applied on each chunk
+ * @param grain the maximum number of elements of a chunk (at least 1)
+ * @param policy the balancing policy of the scheduler (@see Scheduler::Policy)
+ * @throw any exception thrown by @p body
+ */
+template<typename Index, typename Body>
+void parallel_for(Pool &pool, Index first, Index last, const Body &body, std::size_t grain = 1,
+                  Scheduler::Policy policy = Scheduler::Policy::best);
+
+
+namespace detail {
+    // The state shared by the jobs of a parallel_for
+    struct Loop {
+        Scheduler scheduler;
+        bool keep_left;  // Whether a worker keeps the left half of a range, and schedules the right one, or vice versa
+        std::atomic_bool cancelled;
+        std::exception_ptr failure;
+        std::mutex mtx;
+
+        Loop(unsigned long n_workers, Scheduler::Policy policy, unsigned long capacity, bool keep_left)
+                : scheduler(n_workers, policy, capacity), keep_left(keep_left), cancelled(false) {}
+
+        void fail(std::exception_ptr error) {
+            std::unique_lock<std::mutex> lock(mtx);
+
+            if (!failure)
+                failure = error;
+
+            cancelled.store(true, std::memory_order_relaxed);
+        }
+    };
+
+    template<typename Index, typename Body>
+    void split_range(Loop &loop, Index first, Index last, const Body &body, std::size_t grain, unsigned long id) {
+        while (static_cast<std::size_t>(last - first) > grain) {
+            if (loop.cancelled.load(std::memory_order_relaxed))
+                return;
+
+            Index mid = first + (last - first)/2;
+            Index begin = loop.keep_left ? mid : first, end = loop.keep_left ? last : mid;
+
+            loop.scheduler.schedule([&loop, begin, end, &body, grain](unsigned long id) {
+                split_range(loop, begin, end, body, grain, id);
+            }, id);
+
+            if (loop.keep_left)
+                last = mid;
+            else
+                first = mid;
+        }
+
+        if (loop.cancelled.load(std::memory_order_relaxed))
+            return;
+
+        try {
+            body(first, last);
+        } catch (...) {
+            loop.fail(std::current_exception());
+        }
+    }
+
+    template<typename Index, typename Body>
+    void run_range(Pool &pool, Index first, Index last, const Body &body, std::size_t grain, Scheduler::Policy policy,
+                   bool keep_left) {
+        if (!(first < last))
+            return;
+
+        grain = std::max(grain, static_cast<std::size_t>(1));
+
+        Loop loop(pool.size(), policy, pool.capacity(), keep_left);
+
+        // The first worker is the only one surely running, even if the pool is resized
+        loop.scheduler.schedule([&](unsigned long id) {
+            split_range(loop, first, last, body, grain, id);
+        }, 0ul);
+
+        // The scheduler follows the pool, if it is resized while the loop is running
+        pool.run([&](unsigned long id) {
+            while (loop.scheduler.compute_next(id));
+        }, [&](unsigned long workers) {
+            loop.scheduler.resize(workers);
+        });
+
+        if (loop.failure)
+            std::rethrow_exception(loop.failure);
+    }
+}
+
+template<typename Index, typename Body>
+void parallel_for(Pool &pool, Index first, Index last, const Body &body, std::size_t grain,
+                  Scheduler::Policy policy) {
+    detail::run_range(pool, first, last, body, grain, policy, true);
+}
+
+#endif //SPM_PROJECT_PARALLEL_FOR_H
@@ -0,0 +1,123 @@
+/**
+ * @file pool.h
+ * @brief Contains the Pool class header.
+ */
+
+#ifndef SPM_PROJECT_POOL_H
+#define SPM_PROJECT_POOL_H
+
+#include <functional>
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+/**
+ * @class Pool
+ * @brief A persistent set of parallel threads.
+ *
+ * The threads are spawned once, when the pool is created, and are kept alive (waiting) until the pool is destroyed.
+ * Every call to run() wakes them up and makes them execute the same task, each one with its own worker ID, so that
+ * multiple computations (e.g., several DAC::compute or parallel_for calls) can share the same threads instead of
+ * spawning new ones every time.
+ *
+ * The number of workers can be changed at any time, within the capacity of the pool (@see resize). The workers are
+ * always the ones with the lowest IDs, i.e., the IDs between 0 and size() - 1.
+ */
+class Pool {
+public:
+    using TaskType = std::function<void(unsigned long)>; /** Type alias */
+    using ResizeType = std::function<void(unsigned long)>; /** Type alias */
+
+    /**
+     * Creates a Pool instance, spawning @p capacity - 1 threads (the thread calling run() is the last one, and it
+     * acts as a worker only if the pool is at full capacity).
+     *
+     * @param n_workers the number of parallel workers (i.e., the parallelism degree). It should be at least 1.
+     * @param capacity the maximum number of workers (@see resize), or 0 to use @p n_workers
+     */
+    explicit Pool(unsigned long n_workers = std::thread::hardware_concurrency(), unsigned long capacity = 0ul);
+
+    /**
+     * Stops and joins all the threads of the pool.
+     */
+    ~Pool();
+
+    Pool(const Pool &) = delete;
+    Pool &operator=(const Pool &) = delete;
+
+    /**
+     * Executes @p task on every worker of the pool, passing to each one its ID (a number between 0 and size() - 1).
+     * If the pool is at full capacity, the calling thread will act as the worker with ID size() - 1. This method
+     * returns only when every worker has completed the task. Concurrent calls are serialized.
+     *
+     * If the pool is enlarged while the task is running, the task is executed by the new workers as well (including
+     * the ones removed earlier: if they are still returning from it, they execute it again). If it is shrunk, the
+     * running task is not interrupted: it is up to the task to stop the workers that have been removed (e.g., a
+     * resized Scheduler does it). Hence, @p resized is called with the new number of workers at every resize, before
+     * the workers added start, and once with the initial one, before any worker starts. It is called with the pool
+     * locked, so it must not call the methods of the pool.
+     *
+     * If @p task throws an exception on some worker, the other workers are not interrupted: the first exception is
+     * rethrown once every worker has completed (or left) the task, and the pool can be used again.
+     *
+     * @throw any exception thrown by @p task
+     * @param task the function to be executed by each worker
+     * @param resized the function to be called when the number of workers changes, if any
+     */
+    void run(const TaskType &task, const ResizeType &resized = nullptr);
+
+    /**
+     * Changes the number of workers. It may be called at any time, by any thread.
+     *
+     * @param n_workers the new number of workers, that will be clamped between 1 and capacity()
+     * @return the new number of workers
+     */
+    unsigned long resize(unsigned long n_workers);
+
+    /**
+     * @return the number of workers of the pool (calling thread included, if the pool is at full capacity)
+     */
+    unsigned long size() const;
+
+    /**
+     * @return the maximum number of workers of the pool
+     */
+    unsigned long capacity() const;
+
+private:
+    std::vector<std::thread> threads;
+    std::vector<bool> joined;  // Whether each worker (the last one is the calling thread) has to run the current task
+    std::vector<bool> rejoin;  // Whether each worker has been enlisted again while returning from the current task
+    std::mutex mtx, run_mtx;
+    std::condition_variable start_cv, done_cv;
+    const TaskType *task;
+    const ResizeType *resized;
+    std::exception_ptr failure;  // The first exception thrown by the current task
+    unsigned long running;
+    std::atomic_ulong n_workers;
+    bool stop;
+
+    void loop(unsigned long id);
+
+    // Makes the worker run the current task (again, if it is enlisted while returning from it), with mtx locked
+    void work(std::unique_lock<std::mutex> &lock, unsigned long id);
+
+    // Executes the current task on the given worker, keeping the first exception thrown
+    void execute(const TaskType &task, unsigned long id);
+
+    // Makes the workers between @p first and @p last run the current task (again, if they are already running it)
+    void enlist(unsigned long first, unsigned long last);
+};
+
+/**
+ * Reads the CPU quota of the cgroup of the process, i.e., the CPU time it may use per unit of time: from cpu.max
+ * (cgroup v2), or from cpu.cfs_quota_us and cpu.cfs_period_us (cgroup v1).
+ *
+ * @return the number of CPUs granted by the quota (rounded up), or 0 if there is no quota (or it cannot be read)
+ */
+unsigned long cpu_quota();
+
+#endif //SPM_PROJECT_POOL_H
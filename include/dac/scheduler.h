@@ -12,6 +12,11 @@
 #include <vector>
 #include <list>
 #include <queue>
+#include <set>
+#include <atomic>
+#include <chrono>
+#include "cache_aligned.h"
+#include "trace.h"
 
 #ifdef DEBUG
 #include <iostream>
@@ -26,6 +31,18 @@
  *
  * This scheduler divides the scheduled tasks over multiple threads, each one owning a local queue of jobs, and a global
  * queue accessible by all threads.
+ *
+ * The state owned by each thread lies on its own cache lines, and the number of remaining jobs (used by the balancing
+ * test) is only approximated: every thread accumulates the jobs it schedules and completes in a private delta, which
+ * is folded into a shared counter only when it grows larger than a fraction of the expected jobs per thread. Hence,
+ * scheduling and completing a job rarely writes to memory shared with other threads. The end of the computation, on
+ * the other hand, is detected exactly by counting the jobs in the global queue plus the threads that still have local
+ * jobs, a number that changes only when the global queue is accessed (thus, under its lock).
+ *
+ * The decisions of the scheduler can be recorded in a Trace, and replayed in a later run (@see Trace).
+ *
+ * The number of threads can be changed while the jobs are being computed, within the capacity of the scheduler
+ * (@see resize). A thread that is removed moves its local jobs in the global queue, and stops computing.
  */
 class Scheduler {
 public:
@@ -42,7 +59,9 @@ public:
      *     - "relaxed": the probability to observe the current size of local queue of the thread is higher than 0.005;
      *     - "strict": the probability to observe the current size of local queue of the thread is higher than 0.05;
      *     - "strong": the probability to observe the current size of local queue of the thread is higher than 0.5;
-     *     - "best": a probability that depends on the number of parallel processors.
+     *     - "best": a probability that depends on the number of parallel processors;
+     *     - "adaptive": as "best", but a task whose estimated cost (@see schedule) is lower than the cost of moving it
+     *     through the global queue (estimated online by every thread) is always kept in the local queue.
      *
      * Other options are:
      *     - "only_local": the task will be scheduled in the given local queue;
@@ -53,34 +72,39 @@ public:
      * will not scale up. Vice versa, the more jobs are scheduled locally, the more we will observe a better
      * parallelization, but they may not be evenly distributed.     *
      */
-    enum class Policy { relaxed, strict, strong, best, only_local, only_global };
+    enum class Policy { relaxed, strict, strong, best, adaptive, only_local, only_global };
 
     /**
      * Creates a Scheduler instance.
      *
      * @param n_workers number of parallel threads used to compute the scheduled tasks
      * @param policy the balancing policy
+     * @param capacity the maximum number of threads (@see resize), or 0 to use @p n_workers
      */
-    explicit Scheduler(unsigned long n_workers = 1ul, Policy policy = Policy::best);
+    explicit Scheduler(unsigned long n_workers = 1ul, Policy policy = Policy::best, unsigned long capacity = 0ul);
 
     /**
-     * Schedules a task to the given thread. It will increase the global job counter by 1.
+     * Schedules a task to the given thread. It will increase the job counter of the thread by 1.
      *
      * @warning It is not ensured that the specified thread will eventually compute the task (it depends on the given
-     *     balancing policy).
+     *     balancing policy). This method should be called either by the thread @p to itself (i.e., by a job that it is
+     *     running) or before the threads start computing the jobs.
      * @param job the task to be executed
      * @param to the recipient thread ID (it should be a number between 0 and @p n_workers - 1)
+     * @param cost the estimated execution time of the task (in nanoseconds), or 0 if unknown. It is only used by the
+     *     "adaptive" policy.
      */
-    void schedule(JobType &&job, unsigned long to);
+    void schedule(JobType &&job, unsigned long to, double cost = 0.);
 
     /**
      * Retrieves a task from the local queue of a given thread. If the local queue is empty, it will be retrieved from
-     * the global queue. It will decrease the global counter by 1.
+     * the global queue. It will decrease the job counter of the thread by 1.
      *
      * @warning If there are no task in the local queue nor in the global one, this method will halt until either a job
-     * is scheduled (either locally or globally) or the internal counter is set to 0.
-     * @param from the thread ID (it should be a number between 0 and @p n_workers - 1)
-     * @return true if a job is found, false if there will be no more jobs to be retrieved.
+     * is scheduled globally or every thread has run out of jobs.
+     * @param from the thread ID (it should be a number between 0 and the capacity - 1)
+     * @return true if a job is found, false if there will be no more jobs to be retrieved, or if the thread has been
+     *     removed (@see resize)
      */
     bool compute_next(unsigned long from);
 
@@ -92,49 +116,154 @@ public:
     void set_policy(Policy policy);
 
     /**
-     * Resets the scheduler. It will erase any pending task and reset the internal job counter.
+     * Resets the scheduler. It will erase any pending task and reset the internal job counters.
      *
+     * @throw std::invalid_argument if a trace is being replayed, and it has been recorded with a different number of
+     *     threads
      * @param n_workers the new number of parallel threads to be employed
      * @param policy the new policy to be adopted
+     * @param capacity the new maximum number of threads (@see resize), or 0 to use @p n_workers
+     */
+    void reset(unsigned long n_workers, Policy policy, unsigned long capacity = 0ul);
+
+    /**
+     * Changes the number of threads computing the jobs. It may be called at any time, by any thread. The threads are
+     * always the ones with the lowest IDs: the ones removed will move their local jobs in the global queue, and they
+     * will stop at their next call to compute_next (returning false), or as soon as they are waiting for a job. The
+     * ones added will start retrieving the jobs from the global queue when they call compute_next.
+     *
+     * @warning The decisions are not recorded nor replayed correctly across a resize (@see record).
+     * @param n_workers the new number of threads, that will be clamped between 1 and the capacity
+     * @return the new number of threads
+     */
+    unsigned long resize(unsigned long n_workers);
+
+    /**
+     * Records the decisions taken from now on in @p trace, which is emptied. It is emptied again at every reset, so it
+     * will contain the decisions taken since the last one. It may be called together with replay, e.g., to check that
+     * a replay takes the same decisions.
+     *
+     * @warning This method should be called while no thread is computing the jobs. Recording the durations of the
+     *     jobs adds the cost of reading the clock twice per job.
+     * @param trace the trace where the decisions will be recorded. It must outlive the recording.
+     */
+    void record(Trace &trace);
+
+    /**
+     * Takes the decisions recorded in @p trace instead of the ones of the balancing policy, from now on. The replay
+     * restarts from the beginning at every reset.
+     *
+     * If the computation diverges from the recorded one (e.g., the jobs scheduled depend on the timing), the replay is
+     * abandoned and the decisions of the balancing policy are taken for the rest of the computation. The divergence is
+     * detected when a worker schedules more jobs than recorded, or when every worker is waiting for a job that is not
+     * in the global queue, while the jobs in the queue are awaited by none of them.
+     *
+     * @warning This method should be called while no thread is computing the jobs. Unless the scheduler is reset,
+     *     @p trace must have been recorded with the current number of threads.
+     * @param trace the recorded trace. It must outlive the replay.
+     */
+    void replay(const Trace &trace);
+
+    /**
+     * Stops both recording and replaying.
      */
-    void reset(unsigned long n_workers, Policy policy);
+    void stop_tracing();
 
 private:
-    using JobList = std::list<JobType>;
+    // A job in a queue, together with its estimated cost (0 if unknown) and its tag (@see Trace)
+    struct QueuedJob {
+        JobType job;
+        double cost;
+        Trace::Tag tag;
+    };
+
+    using JobList = std::list<QueuedJob>;
 
     // This is just a synchronized version of the priority_queue of the standard library. It will be also maintain the
-    // number of remaining jobs to be completed.
+    // number of "active" entities, i.e., the jobs in the queue plus the workers that have local jobs (or are running
+    // one). When it drops to 0, every job has been completed. All its members are only accessed under the lock, so they
+    // are kept together, padded away from the (read-mostly) members of the Scheduler.
     class SyncJobList {
     private:
+        char front_padding[CACHE_LINE_SIZE];
         JobList queue;
         std::mutex mtx;
         std::condition_variable cv;
-        std::atomic_ullong remaining;
+        unsigned long long active;
+        bool selective;  // Whether the threads wait for specific jobs (i.e., replaying a trace)
+        std::multiset<Trace::Tag> awaited;  // The jobs the threads are waiting for, while replaying
+        std::atomic_bool diverged;  // Whether the replay has been abandoned
+        char back_padding[CACHE_LINE_SIZE];
 
     public:
         explicit SyncJobList();
-        void push(JobType &&item);
-        bool pop(JobType &item);
+        void push(QueuedJob &&item);
+
+        // Retrieves the first job, or the one with the given tag (waiting for it). No job has tag Trace::NO_TAG, so
+        // the caller will just wait for the end of the computation. It returns false, without waiting any longer, also
+        // if the caller is not among the first n_workers threads anymore. If all the first n_workers threads wait for
+        // jobs that are not in the queue, and no one else may push them, the replay diverges (@see diverge).
+        bool pop(QueuedJob &item, bool release, unsigned long id, const std::atomic_ulong &n_workers,
+                 const Trace::Tag *tag = nullptr);
+
+        // Moves all the given jobs in the queue, the newest first
+        void push_all(JobList &jobs, bool release);
+        void activate();
+
+        // Wakes up the waiting threads, so that they check whether they have been removed
+        void wake();
+        void set_selective(bool selective);
         void clear();
-        void inc_remaining(unsigned long long by = 1ull);
-        void dec_remaining(unsigned long long by = 1ull);
-        unsigned long long get_remaining();
+
+        // Abandons the replay: from now on, the threads retrieve the first job
+        void diverge();
+        bool has_diverged() const;
     };
 
-    // Parallel worker
-    class Worker {
+    // Parallel worker. Every worker starts on a new cache line, with the fields written on every job on the first one.
+    class alignas(CACHE_LINE_SIZE) Worker {
     private:
         JobList local_list;
+        long long delta;  // Jobs scheduled to this worker minus jobs completed by it, not yet folded
+        bool active;
+        unsigned long spills;
+        double spill_cost;  // Moving average of the time needed to push a job in the global queue (in nanoseconds)
         Scheduler& parent;
         unsigned long id;
 
+        // Tracing state
+        unsigned long long seq;  // Jobs scheduled to this worker so far
+        Trace::Tag current;  // The job running, if any
+        std::chrono::steady_clock::time_point started;  // When the current job started (only if recording)
+        std::size_t next_decision, next_pop;  // Position in the replayed trace
+
         // Computes the Chi-squared test on the local queue, given the number of remaining jobs to be completed
         bool chi_squared_test();
 
+        // Tells whether the oldest local job is too cheap to be moved through the global queue
+        bool too_cheap();
+
+        // Pushes the oldest local job in the global queue, sampling the time needed
+        void spill();
+
+        // Adds the local delta to the shared counter if it is too large w.r.t. the remaining jobs
+        void fold(long long remaining);
+
+        // Tells whether the oldest local job should be moved in the global queue, following the replayed trace if any
+        bool must_spill();
+
     public:
         explicit Worker(Scheduler& parent, unsigned long id);
         bool get_job(JobType &job);
-        void schedule(JobType&& job);
+        void schedule(JobType&& job, double cost);
+        void execute(JobType &job);
+        void job_done();
+
+        // Moves the local jobs in the global queue, before the thread stops
+        void retire();
+
+        // Restarts the tag sequence and the position in the replayed trace
+        void rewind();
 
 #ifdef DEBUG
         std::ofstream file;
@@ -155,6 +284,8 @@ private:
          *         - SC_BGN: the worker started to schedule a job.
          *         - SC_GLB: the job has been scheduled globally;
          *         - SC_LOC: the job has been scheduled locally;
+         *         - CST_LC: the job has been kept local, as it is cheaper than moving it. info1 will contain its
+         *         estimated cost and info2 the estimated cost of the global queue (in nanoseconds);
          *         - CHI_SK: the Chi squared test has been skipped (jobs below average). info1 will contain the number
          *         of job in the local queue and info1 the remaining jobs overall;
          *         - CHI_OK: the Chi squared test has been passed. info1 will contain the Chi squared value and info2
@@ -170,10 +301,28 @@ private:
 #endif
     };
 
-    SyncJobList global_list;
-    std::vector<Worker> workers;
-    unsigned long n_workers;
-    float chi_limit;
+    static constexpr long long FOLD_RATIO = 8ll;
+
+    // A job is worth spilling only if it costs more than SPILL_FACTOR times the push in the global queue, which only
+    // accounts for the lock: the pop on the other end and the cold caches of the thief are assumed to cost the rest
+    static constexpr double SPILL_FACTOR = 8.;
+
+    SyncJobList global_list;  // Padded on both sides
+
+    // Approximate number of remaining jobs. It is written by every thread, hence it is padded away from the
+    // read-mostly members that follow.
+    std::atomic_llong folded;
+    char folded_padding[CACHE_LINE_SIZE];
+    std::vector<Worker, CacheAlignedAllocator<Worker>> workers;  // As many as the capacity
+    std::atomic_ulong n_workers;  // The threads not removed (@see resize)
+    std::atomic<float> chi_limit;
+    Policy policy;
+    bool cost_aware;
+    Trace *recording;
+    const Trace *replaying;
+
+    // Sets the limit of the Chi-squared test, given the policy and the number of threads
+    void set_chi_limit();
 
 #ifdef DEBUG
     static unsigned int ID;
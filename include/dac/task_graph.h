@@ -0,0 +1,110 @@
+/**
+ * @file task_graph.h
+ * @brief Contains the TaskGraph class header.
+ */
+
+#ifndef SPM_PROJECT_TASK_GRAPH_H
+#define SPM_PROJECT_TASK_GRAPH_H
+
+#include <functional>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include "scheduler.h"
+#include "pool.h"
+
+/**
+ * @class TaskGraph
+ * @brief Parallel execution of a directed acyclic graph of tasks.
+ *
+ * Every node of the graph is a task that can be executed only after all its predecessors have been completed. Each
+ * node has a counter of the predecessors still to be completed: the worker that completes the last predecessor of a
+ * node schedules it to itself, so that the node finds the results of (at least) that predecessor in its caches, and the
+ * Scheduler balances the ready nodes between the workers as usual.
+ *
+ * Once built, the graph can be run any number of times: the counters are restored at the beginning of every run.
+ *
+ * If a task throws an exception, the run is cancelled: the nodes not yet started are skipped, and the first exception
+ * thrown is rethrown by run() once every worker has stopped.
+ */
+class TaskGraph {
+public:
+    using TaskType = std::function<void(unsigned long)>; /** Type alias */
+    using NodeId = unsigned long; /** Type alias */
+
+    /**
+     * Creates an empty TaskGraph instance.
+     */
+    TaskGraph();
+
+    /**
+     * Adds a node to the graph.
+     *
+     * @param task the task of the node. It will receive the ID of the worker executing it.
+     * @return the ID of the new node
+     */
+    NodeId add_node(const TaskType &task);
+
+    /**
+     * Adds a dependency between two nodes, so that @p after will be executed only after @p before has been completed.
+     *
+     * @param before the ID of the predecessor
+     * @param after the ID of the successor
+     */
+    void add_dependency(NodeId before, NodeId after);
+
+    /**
+     * @return the number of nodes of the graph
+     */
+    std::size_t size() const;
+
+    /**
+     * Executes every task of the graph, respecting the dependencies.
+     *
+     * @throw std::logic_error if the graph contains a cycle
+     * @throw any exception thrown by a task
+     * @param workers the number of threads to use to execute the graph (i.e., the parallelism degree)
+     * @param policy the balancing policy of the scheduler (@see Scheduler::Policy)
+     */
+    void run(unsigned long workers = 1ul, Scheduler::Policy policy = Scheduler::Policy::best);
+
+    /**
+     * Executes every task of the graph, respecting the dependencies, using the (persistent) threads of @p pool.
+     *
+     * The sources are spread round robin over the workers that start the run. The pool may be resized while the graph
+     * is running (@see Pool::resize): the workers added take part in the run, the ones removed stop after their
+     * current task.
+     *
+     * @throw std::logic_error if the graph contains a cycle
+     * @throw any exception thrown by a task
+     * @param pool the workers used to execute the graph (its size is the parallelism degree)
+     * @param policy the balancing policy of the scheduler (@see Scheduler::Policy)
+     */
+    void run(Pool &pool, Scheduler::Policy policy = Scheduler::Policy::best);
+
+private:
+    struct Node {
+        TaskType task;
+        std::vector<NodeId> successors;
+        unsigned long predecessors;
+    };
+
+    std::vector<Node> nodes;
+    std::unique_ptr<std::atomic_ulong[]> counters;
+    std::size_t n_counters;
+    bool checked;
+    Scheduler scheduler;
+    std::atomic_bool cancelled;
+    std::exception_ptr failure;
+    std::mutex mtx, failure_mtx;
+
+    // Checks that the graph is acyclic (only once after every change)
+    void check();
+
+    void execute(NodeId node, unsigned long id);
+    void fail(std::exception_ptr error);
+};
+
+#endif //SPM_PROJECT_TASK_GRAPH_H
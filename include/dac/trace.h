@@ -0,0 +1,134 @@
+/**
+ * @file trace.h
+ * @brief Contains the Trace class header.
+ */
+
+#ifndef SPM_PROJECT_TRACE_H
+#define SPM_PROJECT_TRACE_H
+
+#include <vector>
+#include <iostream>
+
+/**
+ * @class Trace
+ * @brief A record of the decisions taken by a Scheduler, used to replay or simulate a computation.
+ *
+ * Every job scheduled is identified by a tag, made of the ID of the worker it has been scheduled to and the number of
+ * jobs previously scheduled to that worker. For each worker, the trace contains:
+ *     - the decisions of the balancing policy, i.e., whether the oldest local job has been moved in the global queue
+ *     after each job scheduled (one bit per job);
+ *     - the tags of the jobs retrieved from the global queue, in order;
+ *     - the job tree, i.e., for every job scheduled, the job that was running on the worker at that time and the
+ *     offset from its start, and for every job completed, its duration.
+ *
+ * A Scheduler replaying a trace takes the same decisions and retrieves the same jobs from the global queue, hence
+ * every worker executes exactly the same jobs in the same order, as long as the jobs scheduled depend only on the
+ * input (e.g., they do not depend on the timing, as the memoization does). The job tree, instead, can be simulated
+ * offline with a different number of workers or a different balancing test.
+ */
+class Trace {
+public:
+    using Tag = unsigned long long; /** Type alias */
+
+    /**
+     * @struct Simulation
+     * @brief The outcome of a simulation.
+     */
+    struct Simulation {
+        double makespan;  // Time needed to complete every job (in nanoseconds)
+        unsigned long long jobs;  // Number of jobs executed
+        unsigned long long spilled;  // Number of jobs moved in the global queue
+    };
+
+    static constexpr Tag NO_TAG = ~0ull;
+
+    /**
+     * Creates an empty Trace.
+     */
+    Trace();
+
+    /**
+     * @param worker the ID of the worker the job has been scheduled to
+     * @param seq the number of jobs scheduled to @p worker before this one
+     * @return the tag of the job
+     */
+    static Tag make_tag(unsigned long worker, unsigned long long seq);
+
+    /**
+     * @return the number of workers of the recorded computation
+     */
+    std::size_t size() const;
+
+    /**
+     * @return the number of jobs scheduled in the recorded computation
+     */
+    unsigned long long jobs() const;
+
+    /**
+     * @return the number of jobs moved in the global queue in the recorded computation
+     */
+    unsigned long long spilled() const;
+
+    /**
+     * Tells whether two traces contain the same decisions, regardless of the durations of the jobs.
+     *
+     * @param other the trace to compare with
+     * @return true if the same jobs have been moved in and retrieved from the global queue
+     */
+    bool same_decisions(const Trace &other) const;
+
+    /**
+     * Simulates the execution of the recorded job tree, taking the duration of every job and the time it spawns its
+     * children from the trace, and the decisions from the balancing test of the Scheduler. The cost of the queues is
+     * not simulated.
+     *
+     * @param n_workers the number of workers of the simulated Scheduler
+     * @param chi_limit the limit of the Chi-squared test (@see Scheduler::Policy), e.g. n_workers/(n_workers - 1)
+     *     for "best", a negative number for "only_global" or the maximum float for "only_local"
+     * @return the outcome of the simulation
+     */
+    Simulation simulate(unsigned long n_workers, float chi_limit) const;
+
+    /**
+     * Writes the trace in binary format.
+     *
+     * @param out the output stream
+     */
+    void save(std::ostream &out) const;
+
+    /**
+     * Reads a trace written by save.
+     *
+     * @throw std::runtime_error if the stream does not contain a valid trace
+     * @param in the input stream
+     */
+    void load(std::istream &in);
+
+private:
+    struct Spawn {
+        Tag tag;
+        Tag parent;  // The job running on the worker when this one has been scheduled, or NO_TAG
+        double offset;  // Time elapsed from the start of the parent (in nanoseconds)
+    };
+
+    struct Run {
+        Tag tag;
+        double duration;  // In nanoseconds
+    };
+
+    struct WorkerTrace {
+        std::vector<bool> spilled;
+        std::vector<Tag> popped;
+        std::vector<Spawn> spawns;
+        std::vector<Run> runs;
+    };
+
+    std::vector<WorkerTrace> workers;
+
+    // Empties the trace, preparing it for n_workers
+    void clear(unsigned long n_workers);
+
+    friend class Scheduler;
+};
+
+#endif //SPM_PROJECT_TRACE_H
@@ -0,0 +1,61 @@
+#include <algorithm>
+#include <dac/cost_model.h>
+
+
+constexpr double CostModel::EWMA_WEIGHT;
+
+CostModel::Slot::Slot() : calls{0ul, 0ul, 0ul}, average{{0.}, {0.}, {0.}} {}
+
+// Slots are copied only while the model is being resized, never while it is sampled
+CostModel::Slot::Slot(const Slot &other) : calls{other.calls[0], other.calls[1], other.calls[2]} {
+    for (auto k = 0; k < 3; ++k)
+        average[k].store(other.average[k].load());
+}
+
+CostModel::CostModel(unsigned long n_workers, unsigned long period)
+        : slots(n_workers), period(std::max(period, 1ul)) {}
+
+void CostModel::resize(unsigned long n_workers) {
+    slots.resize(n_workers);
+}
+
+bool CostModel::sample(CostModel::Kind kind, unsigned long worker) {
+    return slots[worker].calls[static_cast<int>(kind)]++ % period == 0ul;
+}
+
+void CostModel::record(CostModel::Kind kind, unsigned long worker, CostModel::Clock::duration elapsed) {
+    auto &average = slots[worker].average[static_cast<int>(kind)];
+    double last = average.load(std::memory_order_relaxed);
+    double value = std::chrono::duration<double, std::nano>(elapsed).count();
+
+    if (last > 0.)
+        value = last + EWMA_WEIGHT*(value - last);
+
+    average.store(value, std::memory_order_relaxed);
+}
+
+double CostModel::estimate(CostModel::Kind kind, unsigned long worker) const {
+    return slots[worker].average[static_cast<int>(kind)].load(std::memory_order_relaxed);
+}
+
+CostModel::Estimates CostModel::estimates() const {
+    double sums[3] = {0., 0., 0.};
+    unsigned long counts[3] = {0ul, 0ul, 0ul};
+
+    for (auto &slot: slots) {
+        for (auto k = 0; k < 3; ++k) {
+            double value = slot.average[k].load(std::memory_order_relaxed);
+
+            if (value > 0.) {
+                sums[k] += value;
+                ++counts[k];
+            }
+        }
+    }
+
+    for (auto k = 0; k < 3; ++k)
+        if (counts[k] > 0ul)
+            sums[k] /= counts[k];
+
+    return {sums[0], sums[1], sums[2]};
+}
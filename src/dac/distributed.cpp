@@ -0,0 +1,223 @@
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <dac/distributed.h>
+
+
+namespace {
+    // Header of a frame: payload length (8 bytes), ID (8 bytes), type (1 byte)
+    constexpr std::size_t HEADER_SIZE = 17;
+
+    void encode(std::uint64_t value, unsigned char *bytes) {
+        for (auto i = 0; i < 8; ++i)
+            bytes[i] = static_cast<unsigned char>(value >> (8*i));
+    }
+
+    std::uint64_t decode(const unsigned char *bytes) {
+        std::uint64_t value = 0;
+
+        for (auto i = 0; i < 8; ++i)
+            value |= static_cast<std::uint64_t>(bytes[i]) << (8*i);
+
+        return value;
+    }
+
+    void write_all(int fd, const char *data, std::size_t size) {
+        while (size > 0) {
+            // MSG_NOSIGNAL: a closed peer is reported as an error, instead of killing the process with SIGPIPE
+            auto sent = ::send(fd, data, size, MSG_NOSIGNAL);
+
+            if (sent < 0 && errno == EINTR)
+                continue;
+
+            if (sent <= 0)
+                throw std::runtime_error(std::string("Channel: cannot send (") + std::strerror(errno) + ")");
+
+            data += sent;
+            size -= static_cast<std::size_t>(sent);
+        }
+    }
+
+    // Returns the number of bytes read, less than size only at the end of the stream
+    std::size_t read_all(int fd, char *data, std::size_t size) {
+        std::size_t total = 0;
+
+        while (total < size) {
+            auto received = ::recv(fd, data + total, size - total, 0);
+
+            if (received < 0 && errno == EINTR)
+                continue;
+
+            if (received < 0)
+                throw std::runtime_error(std::string("Channel: cannot receive (") + std::strerror(errno) + ")");
+
+            if (received == 0)
+                break;
+
+            total += static_cast<std::size_t>(received);
+        }
+
+        return total;
+    }
+}
+
+Channel::Channel(int fd) : fd(fd) {}
+
+Channel::Channel(Channel &&other) noexcept : fd(other.fd) {
+    other.fd = -1;
+}
+
+Channel &Channel::operator=(Channel &&other) noexcept {
+    if (this != &other) {
+        close();
+        fd = other.fd;
+        other.fd = -1;
+    }
+
+    return *this;
+}
+
+Channel::~Channel() {
+    close();
+}
+
+void Channel::send(Frame type, unsigned long long id, const std::string &payload) {
+    unsigned char header[HEADER_SIZE];
+
+    encode(payload.size(), header);
+    encode(id, header + 8);
+    header[16] = static_cast<unsigned char>(type);
+
+    write_all(fd, reinterpret_cast<const char *>(header), HEADER_SIZE);
+    write_all(fd, payload.data(), payload.size());
+}
+
+bool Channel::receive(Frame &type, unsigned long long &id, std::string &payload) {
+    unsigned char header[HEADER_SIZE];
+    auto received = read_all(fd, reinterpret_cast<char *>(header), HEADER_SIZE);
+
+    if (received == 0)
+        return false;
+
+    if (received < HEADER_SIZE)
+        throw std::runtime_error("Channel: truncated frame");
+
+    payload.resize(decode(header));
+    id = decode(header + 8);
+    type = static_cast<Frame>(header[16]);
+
+    if (read_all(fd, &payload[0], payload.size()) < payload.size())
+        throw std::runtime_error("Channel: truncated frame");
+
+    return true;
+}
+
+int Channel::descriptor() const {
+    return fd;
+}
+
+void Channel::close() {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+WorkerProcesses::WorkerProcesses(unsigned long n_processes, const BodyType &body) {
+    channels.reserve(n_processes);
+    pids.reserve(n_processes);
+
+    for (auto i = 0ul; i < n_processes; ++i) {
+        int fds[2];
+
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0) {
+            shutdown();
+            throw std::runtime_error(std::string("WorkerProcesses: cannot create a socket (")
+                                     + std::strerror(errno) + ")");
+        }
+
+        auto pid = fork();
+
+        if (pid < 0) {
+            ::close(fds[0]);
+            ::close(fds[1]);
+            shutdown();
+            throw std::runtime_error(std::string("WorkerProcesses: cannot create a process (")
+                                     + std::strerror(errno) + ")");
+        }
+
+        if (pid == 0) {
+            // The child keeps only its own end: the ones of its siblings must be closed, or they would never see the
+            // end of their streams
+            ::close(fds[0]);
+
+            for (auto &channel: channels)
+                channel.close();
+
+            auto status = EXIT_SUCCESS;
+
+            try {
+                Channel channel(fds[1]);
+                body(channel);
+            } catch (...) {
+                status = EXIT_FAILURE;
+            }
+
+            // Skips the destructors and the exit handlers inherited from the parent
+            _exit(status);
+        }
+
+        ::close(fds[1]);
+        channels.emplace_back(fds[0]);
+        pids.push_back(pid);
+    }
+}
+
+WorkerProcesses::~WorkerProcesses() {
+    shutdown();
+}
+
+void WorkerProcesses::shutdown() {
+    // The processes see the end of their streams, and exit once done with their current frame
+    for (auto &channel: channels)
+        channel.close();
+
+    for (auto pid: pids) {
+        int status;
+
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR);
+    }
+
+    channels.clear();
+    pids.clear();
+}
+
+Channel &WorkerProcesses::operator[](unsigned long i) {
+    return channels[i];
+}
+
+unsigned long WorkerProcesses::size() const {
+    return channels.size();
+}
+
+unsigned long WorkerProcesses::wait_any() {
+    std::vector<pollfd> fds(channels.size());
+
+    for (auto i = 0ul; i < channels.size(); ++i)
+        fds[i] = {channels[i].descriptor(), POLLIN, 0};
+
+    while (poll(fds.data(), fds.size(), -1) < 0)
+        if (errno != EINTR)
+            throw std::runtime_error(std::string("WorkerProcesses: cannot wait (") + std::strerror(errno) + ")");
+
+    for (auto i = 0ul; i < fds.size(); ++i)
+        if (fds[i].revents != 0)
+            return i;
+
+    return 0ul;
+}
@@ -0,0 +1,55 @@
+#include <algorithm>
+#include <cstdint>
+#include <sys/mman.h>
+#include <dac/memory.h>
+
+
+namespace {
+    std::size_t round_up(std::size_t bytes) {
+        return (std::max(bytes, static_cast<std::size_t>(1)) + HUGE_PAGE_SIZE - 1ul)/HUGE_PAGE_SIZE*HUGE_PAGE_SIZE;
+    }
+}
+
+void *huge_alloc(std::size_t bytes, bool explicit_pages) {
+    auto size = round_up(bytes);
+
+#ifdef MAP_HUGETLB
+    if (explicit_pages) {
+        void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+        if (ptr != MAP_FAILED)
+            return ptr;
+    }
+#else
+    (void) explicit_pages;
+#endif
+
+    // The transparent huge pages need an aligned region: allocate one more page, and trim the excess at both ends
+    void *raw = mmap(nullptr, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (raw == MAP_FAILED)
+        throw std::bad_alloc();
+
+    auto begin = reinterpret_cast<std::uintptr_t>(raw);
+    auto aligned = (begin + HUGE_PAGE_SIZE - 1ul)/HUGE_PAGE_SIZE*HUGE_PAGE_SIZE;
+
+    if (aligned > begin)
+        munmap(raw, aligned - begin);
+
+    if (aligned + size < begin + size + HUGE_PAGE_SIZE)
+        munmap(reinterpret_cast<void *>(aligned + size), begin + HUGE_PAGE_SIZE - aligned);
+
+    auto ptr = reinterpret_cast<void *>(aligned);
+
+#ifdef MADV_HUGEPAGE
+    // It is only a hint: if the kernel refuses, the buffer is still usable
+    madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+
+    return ptr;
+}
+
+void huge_free(void *ptr, std::size_t bytes) {
+    if (ptr != nullptr)
+        munmap(ptr, round_up(bytes));
+}
@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <dac/pool.h>
+
+
+namespace {
+    const char *CGROUP_ROOT = "/sys/fs/cgroup";
+
+    // Returns the path of the cgroup of the process in the given hierarchy (the unified one if controller is empty)
+    std::string cgroup_path(const std::string &controller) {
+        std::ifstream in("/proc/self/cgroup");
+        std::string line;
+
+        // Lines are in the form "ID:CONTROLLERS:PATH", e.g., "0::/user.slice" or "4:cpu,cpuacct:/user.slice"
+        while (std::getline(in, line)) {
+            auto first = line.find(':'), second = line.find(':', first + 1ul);
+
+            if (first == std::string::npos || second == std::string::npos)
+                continue;
+
+            std::stringstream controllers(line.substr(first + 1ul, second - first - 1ul));
+            std::string name;
+
+            if (controller.empty() && controllers.str().empty())
+                return line.substr(second + 1ul);
+
+            while (std::getline(controllers, name, ','))
+                if (!controller.empty() && name == controller)
+                    return line.substr(second + 1ul);
+        }
+
+        return "";
+    }
+
+    unsigned long to_cpus(long long quota, long long period) {
+        if (quota <= 0ll || period <= 0ll)
+            return 0ul;
+
+        return static_cast<unsigned long>((quota + period - 1ll)/period);
+    }
+
+    unsigned long read_v2(const std::string &dir) {
+        std::ifstream in(dir + "/cpu.max");
+        std::string max;
+        long long quota, period;
+
+        // "max 100000" if there is no quota
+        if (!(in >> max >> period) || !(std::istringstream(max) >> quota))
+            return 0ul;
+
+        return to_cpus(quota, period);
+    }
+
+    unsigned long read_v1(const std::string &dir) {
+        std::ifstream quota_in(dir + "/cpu.cfs_quota_us"), period_in(dir + "/cpu.cfs_period_us");
+        long long quota, period;
+
+        // A quota of -1 means no quota
+        if (!(quota_in >> quota) || !(period_in >> period))
+            return 0ul;
+
+        return to_cpus(quota, period);
+    }
+}
+
+
+Pool::Pool(unsigned long n_workers, unsigned long capacity)
+        : task(nullptr), resized(nullptr), running(0ul), n_workers(std::max(n_workers, 1ul)), stop(false) {
+    capacity = std::max(capacity, this->n_workers.load());
+    joined.assign(capacity, false);
+    rejoin.assign(capacity, false);
+
+    for (auto id = 0ul; id < capacity - 1ul; ++id)
+        threads.emplace_back(&Pool::loop, this, id);
+}
+
+Pool::~Pool() {
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        stop = true;
+        start_cv.notify_all();
+    }
+
+    for (auto &thread: threads)
+        thread.join();
+}
+
+void Pool::run(const Pool::TaskType &task, const Pool::ResizeType &resized) {
+    std::unique_lock<std::mutex> run_lock(run_mtx);
+    std::unique_lock<std::mutex> lock(mtx);
+    auto caller = joined.size() - 1ul;
+
+    this->task = &task;
+    this->resized = resized ? &resized : nullptr;
+
+    if (this->resized != nullptr)
+        resized(n_workers);
+
+    enlist(0ul, n_workers);
+
+    // The calling thread works only when the pool is at full capacity, possibly after a resize
+    while (true) {
+        if (joined[caller]) {
+            work(lock, caller);
+            continue;
+        }
+
+        if (running == 0ul)
+            break;
+
+        done_cv.wait(lock);
+    }
+
+    this->task = nullptr;
+    this->resized = nullptr;
+
+    if (failure) {
+        auto error = failure;
+        failure = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+unsigned long Pool::resize(unsigned long n_workers) {
+    n_workers = std::min(std::max(n_workers, 1ul), capacity());
+
+    std::unique_lock<std::mutex> lock(mtx);
+    auto old = this->n_workers.exchange(n_workers);
+
+    if (task != nullptr && resized != nullptr && n_workers != old)
+        (*resized)(n_workers);
+
+    if (task != nullptr && n_workers > old)
+        enlist(old, n_workers);
+
+    return n_workers;
+}
+
+unsigned long Pool::size() const {
+    return n_workers.load();
+}
+
+unsigned long Pool::capacity() const {
+    return joined.size();
+}
+
+void Pool::loop(unsigned long id) {
+    std::unique_lock<std::mutex> lock(mtx);
+
+    while (true) {
+        start_cv.wait(lock, [&]() { return stop || joined[id]; });
+
+        if (stop)
+            return;
+
+        work(lock, id);
+    }
+}
+
+void Pool::work(std::unique_lock<std::mutex> &lock, unsigned long id) {
+    // A worker removed and then added again may still be returning from the task, after finding itself removed
+    do {
+        auto current = task;
+        rejoin[id] = false;
+
+        lock.unlock();
+        execute(*current, id);
+        lock.lock();
+    } while (rejoin[id]);
+
+    joined[id] = false;
+
+    if (--running == 0ul)
+        done_cv.notify_one();
+}
+
+void Pool::execute(const Pool::TaskType &task, unsigned long id) {
+    try {
+        task(id);
+    } catch (...) {
+        std::unique_lock<std::mutex> lock(mtx);
+
+        if (!failure)
+            failure = std::current_exception();
+    }
+}
+
+void Pool::enlist(unsigned long first, unsigned long last) {
+    for (auto id = first; id < last; ++id) {
+        if (joined[id]) {
+            rejoin[id] = true;
+            continue;
+        }
+
+        joined[id] = true;
+        ++running;
+    }
+
+    start_cv.notify_all();
+    done_cv.notify_one();
+}
+
+unsigned long cpu_quota() {
+    // In a container the cgroup of the process is usually mounted as the root, hence the root is tried as well
+    std::string root(CGROUP_ROOT);
+
+    for (auto &dir: {root + cgroup_path(""), root}) {
+        auto cpus = read_v2(dir);
+
+        if (cpus > 0ul)
+            return cpus;
+    }
+
+    for (auto &dir: {root + "/cpu" + cgroup_path("cpu"), root + "/cpu,cpuacct" + cgroup_path("cpu"), root + "/cpu"}) {
+        auto cpus = read_v1(dir);
+
+        if (cpus > 0ul)
+            return cpus;
+    }
+
+    return 0ul;
+}
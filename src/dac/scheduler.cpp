@@ -2,6 +2,8 @@
 // Created by flandolfi on 16/03/19.
 //
 
+#include <algorithm>
+#include <stdexcept>
 #include <dac/scheduler.h>
 
 #define P_VALUE_0_750 0.101
@@ -21,9 +23,12 @@
 unsigned int Scheduler::ID = 0;
 #endif
 
-Scheduler::Scheduler(unsigned long n_workers, Scheduler::Policy policy)
-        : global_list(), n_workers(n_workers) {
-    for (auto id = 0ul; id < n_workers; ++id)
+Scheduler::Scheduler(unsigned long n_workers, Scheduler::Policy policy, unsigned long capacity)
+        : global_list(), folded(0ll), n_workers(n_workers), recording(nullptr), replaying(nullptr) {
+    capacity = std::max(capacity, n_workers);
+    workers.reserve(capacity);
+
+    for (auto id = 0ul; id < capacity; ++id)
         workers.emplace_back(*this, id);
 
     set_policy(policy);
@@ -33,12 +38,19 @@ Scheduler::Scheduler(unsigned long n_workers, Scheduler::Policy policy)
 #endif
 }
 
-void Scheduler::schedule(Scheduler::JobType &&job, unsigned long to) {
-    global_list.inc_remaining();
-    workers[to].schedule(std::forward<JobType>(job));
+void Scheduler::schedule(Scheduler::JobType &&job, unsigned long to, double cost) {
+    workers[to].schedule(std::forward<JobType>(job), cost);
 }
 
 void Scheduler::set_policy(Scheduler::Policy policy) {
+    this->policy = policy;
+    cost_aware = policy == Policy::adaptive;
+    set_chi_limit();
+}
+
+void Scheduler::set_chi_limit() {
+    auto n_workers = this->n_workers.load();
+
     switch (policy) {
         case Policy::relaxed:
             chi_limit = P_VALUE_0_005;
@@ -52,6 +64,7 @@ void Scheduler::set_policy(Scheduler::Policy policy) {
             chi_limit = P_VALUE_0_500;
             break;
 
+        case Policy::adaptive:
         case Policy::best:
             if (n_workers >= 2) {
                 chi_limit = n_workers/(n_workers - 1.f);
@@ -68,27 +81,51 @@ void Scheduler::set_policy(Scheduler::Policy policy) {
     }
 }
 
-void Scheduler::reset(unsigned long n_workers, Policy policy) {
+void Scheduler::reset(unsigned long n_workers, Policy policy, unsigned long capacity) {
+    capacity = std::max(capacity, n_workers);
     this->n_workers = n_workers;
     global_list.clear();
+    folded = 0ll;
     workers.clear();
+    workers.reserve(capacity);
 
-    for (auto id = 0ul; id < n_workers; ++id)
+    for (auto id = 0ul; id < capacity; ++id)
         workers.emplace_back(*this, id);
 
     set_policy(policy);
+
+    if (recording != nullptr)
+        recording->clear(capacity);
+
+    if (replaying != nullptr && replaying->size() != capacity)
+        throw std::invalid_argument("Scheduler: the trace has been recorded with a different number of workers");
+}
+
+unsigned long Scheduler::resize(unsigned long n_workers) {
+    n_workers = std::min(std::max(n_workers, 1ul), static_cast<unsigned long>(workers.size()));
+
+    this->n_workers.store(n_workers);
+    set_chi_limit();
+    global_list.wake();
+
+    return n_workers;
 }
 
 bool Scheduler::compute_next(unsigned long from) {
     JobType job;
 
+    if (from >= n_workers.load(std::memory_order_relaxed)) {
+        workers[from].retire();
+        return false;
+    }
+
     bool result = workers[from].get_job(job);
 
     if (!result)
         return false;
 
-    job(from);
-    global_list.dec_remaining();
+    workers[from].execute(job);
+    workers[from].job_done();
 
 #ifdef DEBUG
     workers[from].log("J_DONE", "", "");
@@ -96,3 +133,25 @@ bool Scheduler::compute_next(unsigned long from) {
 
     return true;
 }
+
+void Scheduler::record(Trace &trace) {
+    recording = &trace;
+    trace.clear(workers.size());
+
+    for (auto &worker: workers)
+        worker.rewind();
+}
+
+void Scheduler::replay(const Trace &trace) {
+    replaying = &trace;
+    global_list.set_selective(true);
+
+    for (auto &worker: workers)
+        worker.rewind();
+}
+
+void Scheduler::stop_tracing() {
+    recording = nullptr;
+    replaying = nullptr;
+    global_list.set_selective(false);
+}
@@ -2,50 +2,125 @@
 // Created by flandolfi on 18/03/19.
 //
 
+#include <algorithm>
 #include <dac/scheduler.h>
 
-#define ST_MEM_ORDER std::memory_order_release
-#define LD_MEM_ORDER std::memory_order_consume
 
+Scheduler::SyncJobList::SyncJobList() : active(0ull), selective(false), diverged(false) {}
 
-Scheduler::SyncJobList::SyncJobList() : remaining(0ull) {}
-
-void Scheduler::SyncJobList::push(JobType &&item) {
+void Scheduler::SyncJobList::push(QueuedJob &&item) {
     std::unique_lock<std::mutex> lock(mtx);
 
-    queue.push_back(std::forward<JobType>(item));
-    cv.notify_one();
+    queue.push_back(std::move(item));
+    ++active;
+
+    // Only the thread waiting for this job may go on
+    if (selective)
+        cv.notify_all();
+    else
+        cv.notify_one();
 }
 
-bool Scheduler::SyncJobList::pop(JobType &item) {
+bool Scheduler::SyncJobList::pop(QueuedJob &item, bool release, unsigned long id, const std::atomic_ulong &n_workers,
+                                 const Trace::Tag *tag) {
     std::unique_lock<std::mutex> lock(mtx);
-    cv.wait(lock, [&](){ return !queue.empty() || get_remaining() == 0; });
+    auto it = queue.begin();
+
+    // The caller has run out of local jobs
+    if (release && --active == 0)
+        cv.notify_all();  // All jobs are done, rejoice!
+
+    if (tag != nullptr)
+        awaited.insert(*tag);
+
+    cv.wait(lock, [&]() {
+        if (id >= n_workers.load(std::memory_order_relaxed)) {
+            it = queue.end();
+            return true;
+        }
+
+        if (tag == nullptr || diverged.load(std::memory_order_relaxed)) {
+            it = queue.begin();
+            return it != queue.end() || active == 0;
+        }
+
+        it = std::find_if(queue.begin(), queue.end(), [tag](const QueuedJob &job) { return job.tag == *tag; });
+
+        if (it != queue.end() || active == 0)
+            return true;
+
+        // Nobody is running a job (every active entity is in the queue), and every thread waits for something else
+        bool stuck = awaited.size() >= n_workers.load(std::memory_order_relaxed) && active == queue.size()
+                     && std::none_of(queue.begin(), queue.end(), [this](const QueuedJob &job) {
+                         return awaited.count(job.tag) > 0;
+                     });
+
+        if (!stuck)
+            return false;
+
+        diverged.store(true, std::memory_order_relaxed);
+        cv.notify_all();
+        it = queue.begin();
+
+        return true;
+    });
+
+    if (tag != nullptr)
+        awaited.erase(awaited.find(*tag));
 
-    if (queue.empty())
-        return false;  // No more jobs
+    if (it == queue.end())
+        return false;  // No more jobs, or removed
 
-    item = std::move(queue.front());
-    queue.pop_front();
+    // The job leaves the queue, but the caller becomes active: the counter does not change
+    item = std::move(*it);
+    queue.erase(it);
 
     return true;
 }
 
-void Scheduler::SyncJobList::inc_remaining(unsigned long long by) {
-    remaining.fetch_add(by, ST_MEM_ORDER);
+void Scheduler::SyncJobList::push_all(JobList &jobs, bool release) {
+    std::unique_lock<std::mutex> lock(mtx);
+
+    active += jobs.size();
+
+    // The caller has run out of local jobs
+    if (release)
+        --active;
+
+    // The newest jobs are the deepest in the recursion: the older ones may wait for them
+    jobs.reverse();
+    queue.splice(queue.end(), jobs);
+    cv.notify_all();
 }
 
-void Scheduler::SyncJobList::dec_remaining(unsigned long long by) {
-    if (remaining.fetch_sub(by, ST_MEM_ORDER) - by == 0) {
-        std::unique_lock<std::mutex> lock(mtx);
-        cv.notify_all();  // All jobs are done, rejoice!
-    }
+void Scheduler::SyncJobList::activate() {
+    std::unique_lock<std::mutex> lock(mtx);
+    ++active;
+}
+
+void Scheduler::SyncJobList::wake() {
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.notify_all();
 }
 
-unsigned long long Scheduler::SyncJobList::get_remaining() {
-    return remaining.load(LD_MEM_ORDER);
+void Scheduler::SyncJobList::set_selective(bool selective) {
+    this->selective = selective;
+    diverged = false;
 }
 
 void Scheduler::SyncJobList::clear() {
     queue = JobList();
-    remaining = 0ul;
+    active = 0ull;
+    awaited.clear();
+    diverged = false;
+}
+
+void Scheduler::SyncJobList::diverge() {
+    std::unique_lock<std::mutex> lock(mtx);
+    diverged.store(true, std::memory_order_relaxed);
+    cv.notify_all();
+}
+
+bool Scheduler::SyncJobList::has_diverged() const {
+    return diverged.load(std::memory_order_relaxed);
 }
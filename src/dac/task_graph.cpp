@@ -0,0 +1,145 @@
+#include <stdexcept>
+#include <dac/task_graph.h>
+
+
+TaskGraph::TaskGraph() : n_counters(0), checked(true), scheduler(0), cancelled(false) {}
+
+TaskGraph::NodeId TaskGraph::add_node(const TaskGraph::TaskType &task) {
+    std::unique_lock<std::mutex> lock(mtx);
+
+    nodes.push_back({task, {}, 0ul});
+    return nodes.size() - 1ul;
+}
+
+void TaskGraph::add_dependency(TaskGraph::NodeId before, TaskGraph::NodeId after) {
+    std::unique_lock<std::mutex> lock(mtx);
+
+    if (before >= nodes.size() || after >= nodes.size())
+        throw std::out_of_range("TaskGraph: no such node");
+
+    nodes[before].successors.push_back(after);
+    ++nodes[after].predecessors;
+    checked = false;
+}
+
+std::size_t TaskGraph::size() const {
+    return nodes.size();
+}
+
+void TaskGraph::run(unsigned long workers, Scheduler::Policy policy) {
+    Pool pool(workers);
+    run(pool, policy);
+}
+
+void TaskGraph::run(Pool &pool, Scheduler::Policy policy) {
+    std::unique_lock<std::mutex> lock(mtx);
+    auto workers = pool.size();
+
+    check();
+
+    if (n_counters != nodes.size()) {
+        n_counters = nodes.size();
+        counters.reset(new std::atomic_ulong[n_counters]);
+    }
+
+    scheduler.reset(workers, policy, pool.capacity());
+    cancelled = false;
+    failure = nullptr;
+
+    for (auto node = 0ul; node < nodes.size(); ++node)
+        counters[node].store(nodes[node].predecessors, std::memory_order_relaxed);
+
+    auto placed = false;
+
+    // The scheduler follows the pool, if it is resized while the graph is running. The sources are spread round robin
+    // over the workers that start the run (they are placed before any of them starts, so that none is removed in the
+    // meanwhile), the other nodes will be released by their predecessors.
+    pool.run([this](unsigned long id) {
+        while (scheduler.compute_next(id));
+    }, [this, &placed](unsigned long workers) {
+        scheduler.resize(workers);
+
+        if (placed)
+            return;
+
+        auto next = 0ul;
+
+        for (auto node = 0ul; node < nodes.size(); ++node) {
+            if (nodes[node].predecessors == 0ul) {
+                scheduler.schedule([this, node](unsigned long id) {
+                    execute(node, id);
+                }, next);
+
+                next = (next + 1ul) % workers;
+            }
+        }
+
+        placed = true;
+    });
+
+    if (failure)
+        std::rethrow_exception(failure);
+}
+
+void TaskGraph::check() {
+    if (checked)
+        return;
+
+    // Kahn's algorithm: the graph is acyclic iff every node can be removed after its predecessors
+    std::vector<unsigned long> missing(nodes.size());
+    std::vector<NodeId> ready;
+
+    for (auto node = 0ul; node < nodes.size(); ++node) {
+        missing[node] = nodes[node].predecessors;
+
+        if (missing[node] == 0ul)
+            ready.push_back(node);
+    }
+
+    auto removed = 0ul;
+
+    while (!ready.empty()) {
+        auto node = ready.back();
+        ready.pop_back();
+        ++removed;
+
+        for (auto succ: nodes[node].successors)
+            if (--missing[succ] == 0ul)
+                ready.push_back(succ);
+    }
+
+    if (removed != nodes.size())
+        throw std::logic_error("TaskGraph: the graph contains a cycle");
+
+    checked = true;
+}
+
+void TaskGraph::execute(TaskGraph::NodeId node, unsigned long id) {
+    // After a failure, the successors are not released: the run ends once the nodes already scheduled are drained
+    if (cancelled.load(std::memory_order_relaxed))
+        return;
+
+    try {
+        nodes[node].task(id);
+    } catch (...) {
+        fail(std::current_exception());
+        return;
+    }
+
+    for (auto succ: nodes[node].successors) {
+        if (counters[succ].fetch_sub(1ul, std::memory_order_acq_rel) == 1ul) {
+            scheduler.schedule([this, succ](unsigned long id) {
+                execute(succ, id);
+            }, id);
+        }
+    }
+}
+
+void TaskGraph::fail(std::exception_ptr error) {
+    std::unique_lock<std::mutex> lock(failure_mtx);
+
+    if (!failure)
+        failure = error;
+
+    cancelled.store(true, std::memory_order_relaxed);
+}
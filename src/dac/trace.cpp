@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+#include <dac/trace.h>
+
+// Bits of the tag that hold the sequence number
+#define TAG_SHIFT 40
+
+// First bytes of a saved trace
+#define TRACE_MAGIC 0x54434144u
+
+
+namespace {
+    template<typename T>
+    void write(std::ostream &out, const T &value) {
+        out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    void write(std::ostream &out, const std::vector<T> &values) {
+        write(out, static_cast<unsigned long long>(values.size()));
+        out.write(reinterpret_cast<const char *>(values.data()), values.size()*sizeof(T));
+    }
+
+    // The decisions are packed, 8 per byte
+    void write(std::ostream &out, const std::vector<bool> &values) {
+        std::vector<unsigned char> bytes((values.size() + 7ul)/8ul, 0u);
+
+        for (auto i = 0ul; i < values.size(); ++i)
+            if (values[i])
+                bytes[i/8ul] |= 1u << (i % 8ul);
+
+        write(out, static_cast<unsigned long long>(values.size()));
+        out.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+    }
+
+    template<typename T>
+    void read(std::istream &in, T &value) {
+        if (!in.read(reinterpret_cast<char *>(&value), sizeof(T)))
+            throw std::runtime_error("Trace: truncated stream");
+    }
+
+    template<typename T>
+    void read(std::istream &in, std::vector<T> &values) {
+        unsigned long long size;
+        read(in, size);
+        values.resize(size);
+
+        if (!in.read(reinterpret_cast<char *>(values.data()), size*sizeof(T)))
+            throw std::runtime_error("Trace: truncated stream");
+    }
+
+    void read(std::istream &in, std::vector<bool> &values) {
+        unsigned long long size;
+        read(in, size);
+
+        std::vector<unsigned char> bytes((size + 7ull)/8ull);
+
+        if (!in.read(reinterpret_cast<char *>(bytes.data()), bytes.size()))
+            throw std::runtime_error("Trace: truncated stream");
+
+        values.resize(size);
+
+        for (auto i = 0ull; i < size; ++i)
+            values[i] = (bytes[i/8ull] >> (i % 8ull)) & 1u;
+    }
+}
+
+constexpr Trace::Tag Trace::NO_TAG;
+
+Trace::Trace() = default;
+
+Trace::Tag Trace::make_tag(unsigned long worker, unsigned long long seq) {
+    return (static_cast<Tag>(worker) << TAG_SHIFT) | seq;
+}
+
+std::size_t Trace::size() const {
+    return workers.size();
+}
+
+unsigned long long Trace::jobs() const {
+    auto result = 0ull;
+
+    for (auto &worker: workers)
+        result += worker.spawns.size();
+
+    return result;
+}
+
+unsigned long long Trace::spilled() const {
+    auto result = 0ull;
+
+    for (auto &worker: workers)
+        result += std::count(worker.spilled.begin(), worker.spilled.end(), true);
+
+    return result;
+}
+
+bool Trace::same_decisions(const Trace &other) const {
+    if (workers.size() != other.workers.size())
+        return false;
+
+    for (auto i = 0ul; i < workers.size(); ++i)
+        if (workers[i].spilled != other.workers[i].spilled || workers[i].popped != other.workers[i].popped)
+            return false;
+
+    return true;
+}
+
+void Trace::clear(unsigned long n_workers) {
+    workers.clear();
+    workers.resize(n_workers);
+}
+
+Trace::Simulation Trace::simulate(unsigned long n_workers, float chi_limit) const {
+    struct Job {
+        double duration;
+        std::vector<std::pair<double, std::size_t>> children;  // Offset and index of the jobs it schedules
+    };
+
+    struct Event {
+        double time;
+        unsigned long long order;  // Events at the same time are processed in the order they are generated
+        unsigned long worker;
+        std::size_t job;
+        bool spawn;  // Otherwise, the end of the job
+
+        bool operator>(const Event &other) const {
+            return time > other.time || (time == other.time && order > other.order);
+        }
+    };
+
+    // Rebuild the job tree
+    std::unordered_map<Tag, std::size_t> index;
+    std::vector<Job> jobs;
+    std::vector<std::pair<unsigned long, std::size_t>> roots;
+
+    for (auto &worker: workers) {
+        for (auto &spawn: worker.spawns) {
+            index.emplace(spawn.tag, jobs.size());
+            jobs.push_back({0., {}});
+        }
+    }
+
+    for (auto &worker: workers)
+        for (auto &run: worker.runs)
+            jobs[index.at(run.tag)].duration = run.duration;
+
+    for (auto w = 0ul; w < workers.size(); ++w) {
+        for (auto &spawn: workers[w].spawns) {
+            if (spawn.parent == NO_TAG)
+                roots.emplace_back(w % n_workers, index.at(spawn.tag));
+            else
+                jobs[index.at(spawn.parent)].children.emplace_back(spawn.offset, index.at(spawn.tag));
+        }
+    }
+
+    for (auto &job: jobs)
+        std::sort(job.children.begin(), job.children.end());
+
+    // Simulate the Scheduler
+    std::vector<std::deque<std::size_t>> local(n_workers);
+    std::deque<std::size_t> global;
+    std::vector<bool> busy(n_workers, false);
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+    unsigned long long order = 0ull, remaining = 0ull;
+    Simulation result{0., 0ull, 0ull};
+
+    auto keep_local = [&](unsigned long w) {
+        float par_degree = n_workers;
+
+        if (par_degree < 2 || chi_limit == std::numeric_limits<float>::max())
+            return true;
+
+        if (chi_limit < 0)
+            return false;
+
+        float obs_jobs = local[w].size() + 1;
+        float exp_jobs = remaining / par_degree;
+
+        if (obs_jobs <= exp_jobs)
+            return true;
+
+        float chi_square = (obs_jobs - exp_jobs)*(obs_jobs - exp_jobs);
+        chi_square += chi_square/(par_degree - 1.f);
+        chi_square /= exp_jobs;
+
+        return chi_square < chi_limit;
+    };
+
+    auto start_next = [&](unsigned long w, double time) {
+        std::size_t job;
+
+        if (!local[w].empty()) {
+            job = local[w].back();
+            local[w].pop_back();
+        } else if (!global.empty()) {
+            job = global.front();
+            global.pop_front();
+        } else {
+            busy[w] = false;
+            return;
+        }
+
+        busy[w] = true;
+        ++result.jobs;
+
+        // A job cannot end before it has scheduled its children
+        double end = time + jobs[job].duration;
+
+        for (auto &child: jobs[job].children) {
+            events.push({time + child.first, order++, w, child.second, true});
+            end = std::max(end, time + child.first);
+        }
+
+        events.push({end, order++, w, job, false});
+    };
+
+    auto schedule = [&](unsigned long w, std::size_t job, double time, bool started) {
+        ++remaining;
+        local[w].push_back(job);
+
+        if (keep_local(w))
+            return;
+
+        global.push_back(local[w].front());
+        local[w].pop_front();
+        ++result.spilled;
+
+        for (auto idle = 0ul; started && idle < n_workers && !global.empty(); ++idle)
+            if (!busy[idle])
+                start_next(idle, time);
+    };
+
+    for (auto &root: roots)
+        schedule(root.first, root.second, 0., false);
+
+    for (auto w = 0ul; w < n_workers; ++w)
+        start_next(w, 0.);
+
+    while (!events.empty()) {
+        auto event = events.top();
+        events.pop();
+
+        if (event.spawn) {
+            schedule(event.worker, event.job, event.time, true);
+        } else {
+            --remaining;
+            result.makespan = event.time;
+            start_next(event.worker, event.time);
+        }
+    }
+
+    return result;
+}
+
+void Trace::save(std::ostream &out) const {
+    write(out, TRACE_MAGIC);
+    write(out, static_cast<unsigned long long>(workers.size()));
+
+    for (auto &worker: workers) {
+        write(out, worker.spilled);
+        write(out, worker.popped);
+        write(out, worker.spawns);
+        write(out, worker.runs);
+    }
+}
+
+void Trace::load(std::istream &in) {
+    unsigned int magic;
+    unsigned long long n_workers;
+
+    read(in, magic);
+
+    if (magic != TRACE_MAGIC)
+        throw std::runtime_error("Trace: not a trace");
+
+    read(in, n_workers);
+    clear(n_workers);
+
+    for (auto &worker: workers) {
+        read(in, worker.spilled);
+        read(in, worker.popped);
+        read(in, worker.spawns);
+        read(in, worker.runs);
+    }
+}
@@ -3,9 +3,14 @@
 //
 
 #include <dac/scheduler.h>
+#include <dac/cost_model.h>
 
+#define SPILL_SAMPLING 16ul
 
-Scheduler::Worker::Worker(Scheduler &parent, unsigned long id) : parent(parent), id(id) {
+
+Scheduler::Worker::Worker(Scheduler &parent, unsigned long id)
+        : delta(0ll), active(false), spills(0ul), spill_cost(0.), parent(parent), id(id), seq(0ull),
+          current(Trace::NO_TAG), next_decision(0ul), next_pop(0ul) {
 #ifdef DEBUG
     char name[20];
     std::sprintf(name, "S%i_W%ld.csv", parent.id, id);
@@ -22,21 +27,38 @@ bool Scheduler::Worker::get_job(Scheduler::JobType &job) {
 #endif
 
     if (local_list.empty()) {
-#ifdef DEBUG
-        bool result = parent.global_list.pop(job);
+        const Trace::Tag *tag = nullptr;
+        QueuedJob item;
+
+        // Past the recorded jobs, the worker has only to wait for the end of the computation
+        if (parent.replaying != nullptr && !parent.global_list.has_diverged()) {
+            auto &popped = parent.replaying->workers[id].popped;
+            tag = next_pop < popped.size() ? &popped[next_pop++] : &Trace::NO_TAG;
+        }
+
+        active = parent.global_list.pop(item, active, id, parent.n_workers, tag);
 
-        if (result)
+#ifdef DEBUG
+        if (active)
             log("RT_GLB", "", "");
         else
             log("NO_JOB", "", "");
-
-        return result;
-#else
-        return parent.global_list.pop(job);
 #endif
+
+        if (!active)
+            return false;
+
+        job = std::move(item.job);
+        current = item.tag;
+
+        if (parent.recording != nullptr)
+            parent.recording->workers[id].popped.push_back(current);
+
+        return true;
     }
 
-    job = std::move(local_list.back());
+    job = std::move(local_list.back().job);
+    current = local_list.back().tag;
     local_list.pop_back();
 
 #ifdef DEBUG
@@ -46,16 +68,35 @@ bool Scheduler::Worker::get_job(Scheduler::JobType &job) {
     return true;
 }
 
-void Scheduler::Worker::schedule(Scheduler::JobType &&job) {
+void Scheduler::Worker::schedule(Scheduler::JobType &&job, double cost) {
 #ifdef DEBUG
     log("SC_BGN", "", "");
 #endif
 
-    local_list.push_back(std::forward<JobType >(job));
+    if (!active) {
+        parent.global_list.activate();
+        active = true;
+    }
+
+    ++delta;
+    auto tag = Trace::make_tag(id, seq++);
+    local_list.push_back({std::forward<JobType >(job), cost, tag});
 
-    if (!chi_squared_test()) {
-        parent.global_list.push(std::move(local_list.front()));
-        local_list.pop_front();
+    bool spilled = must_spill();
+
+    if (parent.recording != nullptr) {
+        auto &trace = parent.recording->workers[id];
+        double offset = 0.;
+
+        if (current != Trace::NO_TAG)
+            offset = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+
+        trace.spilled.push_back(spilled);
+        trace.spawns.push_back({tag, current, offset});
+    }
+
+    if (spilled) {
+        spill();
 
 #ifdef DEBUG
         log("SC_GLB", "", "");
@@ -68,21 +109,72 @@ void Scheduler::Worker::schedule(Scheduler::JobType &&job) {
 #endif
 }
 
+bool Scheduler::Worker::must_spill() {
+    if (parent.replaying != nullptr && !parent.global_list.has_diverged()) {
+        auto &decisions = parent.replaying->workers[id].spilled;
+
+        if (next_decision < decisions.size())
+            return decisions[next_decision++];
+
+        // Past the end of the trace, the computation has diverged from the recorded one
+        parent.global_list.diverge();
+    }
+
+    return !chi_squared_test() && !too_cheap();
+}
+
+bool Scheduler::Worker::too_cheap() {
+    auto cost = local_list.front().cost;
+
+    if (!parent.cost_aware || cost <= 0. || spill_cost <= 0.)
+        return false;
+
+    bool result = cost < Scheduler::SPILL_FACTOR*spill_cost;
+
+#ifdef DEBUG
+    if (result)
+        log("CST_LC", cost, Scheduler::SPILL_FACTOR*spill_cost);
+#endif
+
+    return result;
+}
+
+void Scheduler::Worker::spill() {
+    // Only one push every SPILL_SAMPLING is measured
+    if (spills++ % SPILL_SAMPLING != 0ul) {
+        parent.global_list.push(std::move(local_list.front()));
+        local_list.pop_front();
+
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    parent.global_list.push(std::move(local_list.front()));
+    local_list.pop_front();
+
+    double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    spill_cost = spill_cost > 0. ? spill_cost + CostModel::EWMA_WEIGHT*(elapsed - spill_cost) : elapsed;
+}
+
 bool Scheduler::Worker::chi_squared_test() {
-    float par_degree = parent.n_workers;
+    // Both may change at any time (@see Scheduler::resize)
+    float par_degree = parent.n_workers.load(std::memory_order_relaxed);
+    float chi_limit = parent.chi_limit.load(std::memory_order_relaxed);
 
     // Only local
-    if (par_degree < 2 || parent.chi_limit == std::numeric_limits<float>::max())
+    if (par_degree < 2 || chi_limit == std::numeric_limits<float>::max())
         return true;
 
     // Only global
-    if (parent.chi_limit < 0)
+    if (chi_limit < 0)
         return false;
 
-    auto remaining = parent.global_list.get_remaining();
+    auto remaining = parent.folded.load(std::memory_order_relaxed) + delta;
+    fold(remaining);
 
     // Straight to global (and avoid divide by 0)
-    if (remaining == 0)
+    if (remaining <= 0ll)
         return false;
 
     float obs_jobs = local_list.size() + 1;  // Assume it is working already
@@ -102,13 +194,63 @@ bool Scheduler::Worker::chi_squared_test() {
     chi_square /= exp_jobs;
 
 #ifdef DEBUG
-    if (chi_square < parent.chi_limit)
-        log("CHI_OK", chi_square, parent.chi_limit);
+    if (chi_square < chi_limit)
+        log("CHI_OK", chi_square, chi_limit);
     else
-        log("CHI_NO", chi_square, parent.chi_limit);
+        log("CHI_NO", chi_square, chi_limit);
 #endif
 
-    return chi_square < parent.chi_limit;
+    return chi_square < chi_limit;
+}
+
+void Scheduler::Worker::execute(Scheduler::JobType &job) {
+    if (parent.recording == nullptr) {
+        job(id);
+        current = Trace::NO_TAG;
+
+        return;
+    }
+
+    started = std::chrono::steady_clock::now();
+    job(id);
+
+    double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+    parent.recording->workers[id].runs.push_back({current, elapsed});
+    current = Trace::NO_TAG;
+}
+
+void Scheduler::Worker::job_done() {
+    --delta;
+    fold(parent.folded.load(std::memory_order_relaxed) + delta);
+}
+
+void Scheduler::Worker::fold(long long remaining) {
+    // Every worker holds back at most threshold jobs, i.e., 1/FOLD_RATIO of the remaining jobs over all the workers,
+    // as long as the estimates they computed their thresholds from are still accurate
+    long long threshold = remaining/(FOLD_RATIO*parent.n_workers.load(std::memory_order_relaxed));
+
+    if (delta > threshold || -delta > threshold) {
+        parent.folded.fetch_add(delta, std::memory_order_relaxed);
+        delta = 0ll;
+    }
+}
+
+void Scheduler::Worker::retire() {
+    if (active)
+        parent.global_list.push_all(local_list, true);
+
+    active = false;
+
+    // The jobs moved are still to be completed, by the other workers
+    parent.folded.fetch_add(delta, std::memory_order_relaxed);
+    delta = 0ll;
+}
+
+void Scheduler::Worker::rewind() {
+    seq = 0ull;
+    current = Trace::NO_TAG;
+    next_decision = 0ul;
+    next_pop = 0ul;
 }
 
 #ifdef DEBUG
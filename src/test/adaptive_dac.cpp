@@ -0,0 +1,141 @@
+/*
+
+ Adaptive: check the cost estimates of the DAC functions, and the decisions of the adaptive policy
+
+ The problem is the sum of the integers in a range, divided at once in single integers, so that every job scheduled
+ (but the root) is a base case, whose cost is estimated by the adaptive policy. The base case either
+ returns the integer (a "cheap" leaf, much cheaper than moving it through the global queue), or also spins for a given
+ time (an "expensive" leaf). After every computation the estimates of the three functions must be known, and the one of
+ the expensive base case must be at least its spin time. With more than one worker, the adaptive policy must move
+ fewer cheap leaves in the global queue than the "best" policy. The expensive leaves moved are only reported: they are
+ left to the balancing test only if they cost more than a push in the global queue, which may take arbitrarily long
+ when measured on an oversubscribed machine.
+
+*/
+#include <iostream>
+#include <functional>
+#include <chrono>
+#include <vector>
+#include "../includes/utils.h"
+#include <dac/dac.h>
+using namespace std;
+
+typedef pair<long, long> Operand;
+typedef long Result;
+
+const char *leaf_names[] = {"cheap", "expensive"};
+
+long spin_ns = 0;
+
+
+/*
+ * The divide splits the range in single integers
+ */
+void divide(const Operand &op, std::vector<Operand> &subops)
+{
+    for (auto i = op.first; i < op.second; i++)
+        subops.push_back({i, i + 1});
+}
+
+
+/*
+ * The base case returns the only integer of the range, after spinning (if expensive)
+ */
+void seq(const Operand &op, Result &ret)
+{
+    auto end = chrono::steady_clock::now() + chrono::nanoseconds(spin_ns);
+
+    while (spin_ns > 0 && chrono::steady_clock::now() < end);
+
+    ret = op.first;
+}
+
+
+/*
+ * The Combine sums the results
+ */
+void sum(vector<Result> &ress, Result &ret)
+{
+    ret = 0;
+
+    for (auto r: ress)
+        ret += r;
+}
+
+
+/*
+ * Base case condition
+ */
+bool cond(const Operand &op)
+{
+    return op.second - op.first <= 1;
+}
+
+// Computes the sum of [0, n) recording the decisions of the scheduler, returns the number of jobs moved globally
+unsigned long long run(DAC<Operand, Result> &dac, long n, int nwork, Scheduler::Policy policy)
+{
+    Trace trace;
+    Result res;
+
+    dac.record(trace);
+    dac.compute({0, n}, res, nwork, policy);
+    dac.stop_tracing();
+
+    if (res != n*(n - 1)/2) {
+        fprintf(stderr, "Error: wrong result!!\n");
+        exit(-1);
+    }
+
+    return trace.spilled();
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 5) {
+        cerr << "Usage: " << argv[0] << " <n> <spin_ns> <min_proc> <max_proc>" << endl;
+        exit(-1);
+    }
+    const std::function<void(const Operand &, vector<Operand> &)> div(divide);
+    const std::function<void(const Operand &, Result &)> sq(seq);
+    const std::function<void(vector<Result> &, Result &)> sumf(sum);
+    const std::function<bool(const Operand &)> cf(cond);
+
+    long n = atol(argv[1]);
+    long spin = atol(argv[2]);
+    int min_proc = atoi(argv[3]);
+    int max_proc = atoi(argv[4]);
+
+    printf("Workers,Leaves,Fork (ns),Leaf (ns),Join (ns),Spilled (best),Spilled (adaptive)\n");
+
+    for (auto nwork = min_proc; nwork <= max_proc; nwork *= 2) {
+        for (auto expensive = 0; expensive < 2; expensive++) {
+            DAC<Operand, Result> dac(div, sumf, cf, sq);
+            spin_ns = expensive ? spin : 0;
+
+            // The first run collects the estimates
+            run(dac, n, nwork, Scheduler::Policy::adaptive);
+
+            auto estimates = dac.get_cost_estimates();
+
+            if (estimates.fork <= 0. || estimates.leaf <= 0. || estimates.join <= 0.
+                || (expensive && estimates.leaf < spin)) {
+                fprintf(stderr, "Error: wrong estimates (%s leaves)!!\n", leaf_names[expensive]);
+                exit(-1);
+            }
+
+            auto best = run(dac, n, nwork, Scheduler::Policy::best);
+            auto adaptive = run(dac, n, nwork, Scheduler::Policy::adaptive);
+
+            if (nwork > 1 && !expensive && adaptive >= best) {
+                fprintf(stderr, "Error: wrong adaptive decisions (%s leaves, %llu spilled, %llu with best)!!\n",
+                        leaf_names[expensive], adaptive, best);
+                exit(-1);
+            }
+
+            printf("%d,%s,%.0f,%.0f,%.0f,%llu,%llu\n", nwork, leaf_names[expensive], estimates.fork, estimates.leaf,
+                   estimates.join, best, adaptive);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,141 @@
+/*
+
+ Budget: sort an array with a mergesort whose results own their memory, with and without a memory budget
+
+ Every base case returns a sorted copy of its part of the array, and every conquer merges two of them in a new vector:
+ since the sub-problems are divided eagerly, without a budget every sub-problem is divided (and held) before the
+ conquers start. The budget caps the sub-problems divided but not yet conquered, and the peak usage of every
+ computation (as accounted by the budget, i.e., the sub-problems and the size of the vectors) is reported. With output
+ slots, the peak number of sub-problems may exceed the budget by at most the depth of the tree per worker.
+
+*/
+#include <iostream>
+#include <functional>
+#include <vector>
+#include <algorithm>
+#include "../includes/utils.h"
+#include <dac/dac.h>
+using namespace std;
+#define CUTOFF 2000
+
+struct ops {
+    vector<int>::const_iterator left;
+    vector<int>::const_iterator right;
+};
+
+typedef struct ops Operand;
+typedef vector<int> Result;
+
+
+/*
+ * The divide simply 'split' the array in two
+ */
+void divide(const Operand &op, std::vector<Operand> &subops)
+{
+    auto mid = op.left + (op.right - op.left)/2;
+    subops.push_back({op.left, mid});
+    subops.push_back({mid, op.right});
+}
+
+
+/*
+ * For the base case we sort a copy of the array
+ */
+void seq(const Operand &op, Result &ret)
+{
+    ret.assign(op.left, op.right);
+    std::sort(ret.begin(), ret.end());
+}
+
+
+/*
+ * The Merge (Combine) function builds a new sorted array from the two of the sub-problems
+ */
+void mergeMS(vector<Result> &ress, Result &ret)
+{
+    ret.resize(ress[0].size() + ress[1].size());
+    std::merge(ress[0].begin(), ress[0].end(), ress[1].begin(), ress[1].end(), ret.begin());
+
+    // The inputs are not needed anymore
+    ress[0] = Result();
+    ress[1] = Result();
+}
+
+
+/*
+ * Base case condition
+ */
+bool cond(const Operand &op)
+{
+    return op.right - op.left <= CUTOFF;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 5) {
+        cerr << "Usage: " << argv[0] << " <num_elements> <min_proc> <max_proc> <num_trials>" << endl;
+        exit(-1);
+    }
+    const std::function<void(const Operand &, vector<Operand> &)> div(divide);
+    const std::function<void(const Operand &, Result &)> sq(seq);
+    const std::function<void(vector<Result> &, Result &)> mergef(mergeMS);
+    const std::function<bool(const Operand &)> cf(cond);
+
+    int num_elem = atoi(argv[1]);
+    int min_proc = atoi(argv[2]);
+    int max_proc = atoi(argv[3]);
+    int num_trials = atoi(argv[4]);
+
+    // Depth of the recursion tree
+    unsigned long depth = 1;
+
+    while ((num_elem >> depth) > CUTOFF)
+        depth++;
+
+    int *data = generateRandomArray(num_elem);
+    vector<int> input(data, data + num_elem);
+    delete[] data;
+
+
+    printf("Workers,Slots,Budget,Peak tasks,Peak (KB),Time (ms)\n");
+
+    for (auto nwork = min_proc; nwork <= max_proc; nwork *= 2) {
+        for (auto slots = 0; slots < 2; slots++) {
+            // No limit, the tightest one, or a few tasks per worker
+            for (auto budget: {0ul, 1ul, 8ul*nwork}) {
+                for (auto trial = 0; trial < num_trials; trial++) {
+                    DAC<Operand, Result> dac(div, mergef, cf, sq);
+                    Result res;
+
+                    dac.set_output_slots(slots);
+                    dac.set_budget(budget, [](const Result &r) { return r.capacity()*sizeof(int); });
+
+                    long start_t = current_time_usecs();
+
+                    //compute
+                    dac.compute({input.cbegin(), input.cend()}, res, nwork);
+
+                    long end_t = current_time_usecs();
+
+                    //Correctness check
+                    if (res.size() != input.size() || !std::is_sorted(res.begin(), res.end())) {
+                        fprintf(stderr, "Error: array not sorted!!\n");
+                        exit(-1);
+                    }
+
+                    auto usage = dac.get_peak_usage();
+
+                    if (slots && budget > 0ul && usage.tasks > budget + depth*nwork) {
+                        fprintf(stderr, "Error: budget exceeded (%lu tasks)!!\n", usage.tasks);
+                        exit(-1);
+                    }
+
+                    printf("%d,%d,%lu,%lu,%lu,%ld\n", nwork, slots, budget, usage.tasks, usage.bytes/1024ul,
+                           end_t - start_t);
+                }
+            }
+        }
+    }
+
+    return 0;
+}
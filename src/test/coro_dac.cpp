@@ -0,0 +1,119 @@
+/*
+
+ Coroutines: sort an array of N integers with a mergesort written as a C++20 coroutine
+
+ The recursion is written as a plain recursive function: the left half is spawned as a new task (that may be moved to
+ another worker by the scheduler), the right half is sorted by the current task, and the two are merged once the
+ spawned one has completed. No worker blocks while waiting for a child.
+
+*/
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include "../includes/utils.h"
+#include <dac/coro.h>
+using namespace std;
+#define CUTOFF 2000
+
+
+Task<void> mergesort(int *left, int *right)
+{
+    if (right - left <= CUTOFF) {
+        std::sort(left, right);
+        co_return;
+    }
+
+    int *mid = left + (right - left)/2;
+
+    auto child = co_await spawn(mergesort(left, mid));
+    co_await mergesort(mid, right);
+    co_await std::move(child);
+
+    std::inplace_merge(left, mid, right);
+}
+
+
+/*
+ * A task with a result, that fails on a given input
+ */
+Task<long> sum(const int *left, const int *right, const int *fail)
+{
+    if (left <= fail && fail < right && right - left <= CUTOFF)
+        throw runtime_error("failure");
+
+    if (right - left <= CUTOFF) {
+        long result = 0;
+
+        for (auto it = left; it < right; it++)
+            result += *it;
+
+        co_return result;
+    }
+
+    const int *mid = left + (right - left)/2;
+
+    auto child = co_await spawn(sum(left, mid, fail));
+    long result = co_await sum(mid, right, fail);
+
+    co_return result + co_await std::move(child);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 5) {
+        cerr << "Usage: " << argv[0] << " <num_elements> <min_proc> <max_proc> <num_trials>" << endl;
+        exit(-1);
+    }
+
+    int num_elem = atoi(argv[1]);
+    int min_proc = atoi(argv[2]);
+    int max_proc = atoi(argv[3]);
+    int num_trials = atoi(argv[4]);
+
+
+    printf("Workers,Time (ms)\n");
+
+    for (auto nwork = min_proc; nwork <= max_proc; nwork *= 2) {
+        Pool pool(nwork);
+
+        for (auto trial = 0; trial < num_trials; trial++) {
+            int *numbers = generateRandomArray(num_elem);
+            vector<int> v(numbers, numbers + num_elem);
+            delete[] numbers;
+
+            long expected = 0;
+
+            for (auto x: v)
+                expected += x;
+
+            long start_t = current_time_usecs();
+
+            //compute
+            sync_wait(pool, mergesort(v.data(), v.data() + num_elem));
+
+            long end_t = current_time_usecs();
+
+            //Correctness check
+            if (!std::is_sorted(v.begin(), v.end())) {
+                fprintf(stderr, "Error: array not sorted!!\n");
+                exit(-1);
+            }
+
+            if (sync_wait(pool, sum(v.data(), v.data() + num_elem, nullptr)) != expected) {
+                fprintf(stderr, "Error: wrong sum!!\n");
+                exit(-1);
+            }
+
+            try {
+                sync_wait(pool, sum(v.data(), v.data() + num_elem, v.data() + num_elem/3));
+                fprintf(stderr, "Error: exception not propagated!!\n");
+                exit(-1);
+            } catch (runtime_error &) {}
+
+            printf("%d,%ld\n", nwork, end_t - start_t);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,247 @@
+/*
+
+ Distributed: sort an array of N integers with a mergesort spread over multiple processes
+
+ The master process divides the array until every worker process has a few parts to sort, sends them to the worker
+ processes (through Unix domain sockets), and merges the sorted parts it receives back. Each worker process sorts its
+ parts with a DAC running on its own threads. A failing base case is also checked to be reported to the master.
+
+ Then, a hash of a range of integers is computed over an irregular recursion tree, where some ranges are divided in no
+ parts at all (as in the output slots test): the master must conquer them as well, including a root divided in no parts.
+
+*/
+#include <iostream>
+#include <functional>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include "../includes/utils.h"
+#include <dac/distributed.h>
+using namespace std;
+#define CUTOFF 2000
+
+typedef vector<int> Operand;
+typedef vector<int> Result;
+struct range {
+    long first;
+    long second;
+};
+
+typedef struct range Range;
+typedef unsigned long Hash;
+
+// Set by the master before the computation: the worker processes inherit it
+bool fail = false;
+
+
+/*
+ * The divide simply 'split' the array in two
+ */
+void divide(const Operand &op, std::vector<Operand> &subops)
+{
+    auto mid = op.begin() + op.size()/2;
+    subops.emplace_back(op.begin(), mid);
+    subops.emplace_back(mid, op.end());
+}
+
+
+/*
+ * For the base case we sort a copy of the array
+ */
+void seq(const Operand &op, Result &ret)
+{
+    if (fail)
+        throw runtime_error("failure");
+
+    ret = op;
+    std::sort(ret.begin(), ret.end());
+}
+
+
+/*
+ * The Merge (Combine) function builds a new sorted array from the two of the sub-problems
+ */
+void mergeMS(vector<Result> &ress, Result &ret)
+{
+    ret.resize(ress[0].size() + ress[1].size());
+    std::merge(ress[0].begin(), ress[0].end(), ress[1].begin(), ress[1].end(), ret.begin());
+}
+
+
+/*
+ * Base case condition
+ */
+bool cond(const Operand &op)
+{
+    return op.size() <= CUTOFF;
+}
+
+
+/*
+ * Both the sub-problems and the results are arrays, sent as raw bytes
+ */
+void encode(const vector<int> &v, string &bytes)
+{
+    bytes.append(reinterpret_cast<const char *>(v.data()), v.size()*sizeof(int));
+}
+
+void decode(const string &bytes, vector<int> &v)
+{
+    v.resize(bytes.size()/sizeof(int));
+    memcpy(v.data(), bytes.data(), v.size()*sizeof(int));
+}
+
+
+/*
+ * The hash divides a range in two parts, or in no parts
+ */
+void hashDivide(const Range &op, std::vector<Range> &subops)
+{
+    if (op.first % 7 == 3)
+        return;
+
+    subops.push_back({op.first, op.first + (op.second - op.first)/2});
+    subops.push_back({op.first + (op.second - op.first)/2, op.second});
+}
+
+void hashSeq(const Range &op, Hash &ret)
+{
+    ret = 7;
+
+    for (auto i = op.first; i < op.second; i++)
+        ret = ret*31 + i;
+}
+
+// No results give a constant
+void hashCombine(vector<Hash> &ress, Hash &ret)
+{
+    ret = 11 + ress.size();
+
+    for (auto r: ress)
+        ret = ret*131 + r;
+}
+
+bool hashCond(const Range &op)
+{
+    return op.second - op.first <= CUTOFF;
+}
+
+template<typename T>
+void encodeValue(const T &value, string &bytes)
+{
+    bytes.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template<typename T>
+void decodeValue(const string &bytes, T &value)
+{
+    memcpy(&value, bytes.data(), sizeof(T));
+}
+
+// Sequential recursion, used as reference
+Hash hashReference(const Range &op)
+{
+    Hash ret;
+
+    if (hashCond(op)) {
+        hashSeq(op, ret);
+        return ret;
+    }
+
+    vector<Range> subops;
+    hashDivide(op, subops);
+
+    vector<Hash> ress;
+
+    for (auto &subop: subops)
+        ress.push_back(hashReference(subop));
+
+    hashCombine(ress, ret);
+
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 5) {
+        cerr << "Usage: " << argv[0] << " <num_elements> <min_proc> <max_proc> <num_trials> [workers_per_proc]" << endl;
+        exit(-1);
+    }
+    const std::function<void(const Operand &, vector<Operand> &)> div(divide);
+    const std::function<void(const Operand &, Result &)> sq(seq);
+    const std::function<void(vector<Result> &, Result &)> mergef(mergeMS);
+    const std::function<bool(const Operand &)> cf(cond);
+    const std::function<void(const vector<int> &, string &)> enc(encode);
+    const std::function<void(const string &, vector<int> &)> dec(decode);
+
+    int num_elem = atoi(argv[1]);
+    int min_proc = atoi(argv[2]);
+    int max_proc = atoi(argv[3]);
+    int num_trials = atoi(argv[4]);
+    int num_work = argc > 5 ? atoi(argv[5]) : 1;
+
+    DistributedDAC<Operand, Result> dac(div, mergef, cf, sq, enc, dec, enc, dec);
+
+
+    printf("Processes,Workers,Time (ms)\n");
+
+    for (auto nproc = min_proc; nproc <= max_proc; nproc *= 2) {
+        for (auto trial = 0; trial < num_trials; trial++) {
+            int *numbers = generateRandomArray(num_elem);
+            Operand op(numbers, numbers + num_elem);
+            Result res;
+            delete[] numbers;
+
+            long start_t = current_time_usecs();
+
+            //compute
+            dac.compute(op, res, nproc, num_work);
+
+            long end_t = current_time_usecs();
+
+            //Correctness check
+            if (res.size() != op.size() || !std::is_sorted(res.begin(), res.end())) {
+                fprintf(stderr, "Error: array not sorted!!\n");
+                exit(-1);
+            }
+
+            fail = true;
+
+            try {
+                dac.compute(op, res, nproc, num_work);
+                fprintf(stderr, "Error: exception not propagated!!\n");
+                exit(-1);
+            } catch (runtime_error &) {}
+
+            fail = false;
+
+            printf("%d,%d,%ld\n", nproc, num_work, end_t - start_t);
+        }
+    }
+
+    const std::function<void(const Range &, vector<Range> &)> hdiv(hashDivide);
+    const std::function<void(const Range &, Hash &)> hsq(hashSeq);
+    const std::function<void(vector<Hash> &, Hash &)> hcomb(hashCombine);
+    const std::function<bool(const Range &)> hcf(hashCond);
+    const std::function<void(const Range &, string &)> henc_in(encodeValue<Range>);
+    const std::function<void(const string &, Range &)> hdec_in(decodeValue<Range>);
+    const std::function<void(const Hash &, string &)> henc_out(encodeValue<Hash>);
+    const std::function<void(const string &, Hash &)> hdec_out(decodeValue<Hash>);
+
+    DistributedDAC<Range, Hash> hash_dac(hdiv, hcomb, hcf, hsq, henc_in, hdec_in, henc_out, hdec_out);
+
+    // The last root is divided in no parts
+    for (auto &op: vector<Range>{{0, num_elem}, {1, num_elem + 1}, {3, num_elem + 3}}) {
+        Hash res;
+        hash_dac.compute(op, res, max_proc, num_work);
+
+        if (res != hashReference(op)) {
+            fprintf(stderr, "Error: wrong hash ([%ld, %ld))!!\n", op.first, op.second);
+            exit(-1);
+        }
+    }
+
+    return 0;
+}
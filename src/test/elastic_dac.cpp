@@ -0,0 +1,212 @@
+/*
+
+ Elastic: sort an array of N integers with a mergesort, while the number of workers changes during the computation
+
+ The pool is created with the maximum number of workers as its capacity, but with a single worker. While the array is
+ sorted, another thread keeps resizing the computation (cycling from 1 to the capacity and back), both with promises
+ and with output slots. Then, for every capacity, the array is sorted while the computation is enlarged, shrunk (through
+ its pool) and enlarged again at once, before the root is divided: the base cases must be sorted by more than one
+ thread, i.e., the workers added must execute jobs. Finally, the array is sorted once more following the CPU quota of the cgroup, if any.
+
+*/
+#include <iostream>
+#include <functional>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include "../includes/utils.h"
+#include <dac/dac.h>
+using namespace std;
+#define CUTOFF 2000
+
+struct ops {
+    vector<int>::const_iterator left;
+    vector<int>::const_iterator right;
+};
+
+typedef struct ops Operand;
+typedef vector<int> Result;
+
+// The threads that have sorted some base case, and the root to be divided only after the resizes (if any)
+mutex threads_mtx;
+set<thread::id> threads;
+const int *held_root = nullptr;
+atomic_bool released(true);
+
+
+/*
+ * The divide simply 'split' the array in two
+ */
+void divide(const Operand &op, std::vector<Operand> &subops)
+{
+    while (&*op.left == held_root && !released)
+        this_thread::yield();
+
+    auto mid = op.left + (op.right - op.left)/2;
+    subops.push_back({op.left, mid});
+    subops.push_back({mid, op.right});
+}
+
+
+/*
+ * For the base case we sort a copy of the array
+ */
+void seq(const Operand &op, Result &ret)
+{
+    ret.assign(op.left, op.right);
+    std::sort(ret.begin(), ret.end());
+
+    unique_lock<mutex> lock(threads_mtx);
+    threads.insert(this_thread::get_id());
+}
+
+
+/*
+ * The Merge (Combine) function builds a new sorted array from the two of the sub-problems
+ */
+void mergeMS(vector<Result> &ress, Result &ret)
+{
+    ret.resize(ress[0].size() + ress[1].size());
+    std::merge(ress[0].begin(), ress[0].end(), ress[1].begin(), ress[1].end(), ret.begin());
+}
+
+
+/*
+ * Base case condition
+ */
+bool cond(const Operand &op)
+{
+    return op.right - op.left <= CUTOFF;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 5) {
+        cerr << "Usage: " << argv[0] << " <num_elements> <min_proc> <max_proc> <num_trials>" << endl;
+        exit(-1);
+    }
+    const std::function<void(const Operand &, vector<Operand> &)> div(divide);
+    const std::function<void(const Operand &, Result &)> sq(seq);
+    const std::function<void(vector<Result> &, Result &)> mergef(mergeMS);
+    const std::function<bool(const Operand &)> cf(cond);
+
+    int num_elem = atoi(argv[1]);
+    int min_proc = atoi(argv[2]);
+    int max_proc = atoi(argv[3]);
+    int num_trials = atoi(argv[4]);
+
+    int *data = generateRandomArray(num_elem);
+    vector<int> input(data, data + num_elem);
+    delete[] data;
+
+
+    printf("Capacity,Slots,Resizes,Time (ms)\n");
+
+    for (auto nwork = min_proc; nwork <= max_proc; nwork *= 2) {
+        for (auto slots = 0; slots < 2; slots++) {
+            for (auto trial = 0; trial < num_trials; trial++) {
+                DAC<Operand, Result> dac(div, mergef, cf, sq);
+                Pool pool(1, nwork);
+                Result res;
+                atomic_bool done(false);
+                unsigned long resizes = 0;
+
+                dac.set_output_slots(slots);
+
+                // Up to the capacity, and back to a single worker
+                thread resizer([&]() {
+                    unsigned long step = 0;
+
+                    while (!done) {
+                        auto period = 2ul*nwork;
+                        auto phase = step++ % period;
+
+                        if (dac.resize(phase < (unsigned long) nwork ? phase + 1 : period - phase) > 0)
+                            resizes++;
+
+                        this_thread::sleep_for(chrono::microseconds(200));
+                    }
+                });
+
+                long start_t = current_time_usecs();
+
+                //compute
+                dac.compute({input.cbegin(), input.cend()}, res, pool);
+
+                long end_t = current_time_usecs();
+
+                done = true;
+                resizer.join();
+
+                //Correctness check
+                if (res.size() != input.size() || !std::is_sorted(res.begin(), res.end())) {
+                    fprintf(stderr, "Error: array not sorted!!\n");
+                    exit(-1);
+                }
+
+                printf("%d,%d,%lu,%ld\n", nwork, slots, resizes, end_t - start_t);
+            }
+        }
+    }
+
+    printf("Capacity,Slots,Threads\n");
+
+    for (auto nwork = max(min_proc, 2); nwork <= max_proc; nwork *= 2) {
+        for (auto slots = 0; slots < 2; slots++) {
+            DAC<Operand, Result> dac(div, mergef, cf, sq);
+            Pool pool(1, nwork);
+            Result res;
+
+            dac.set_output_slots(slots);
+            threads.clear();
+            held_root = &*input.cbegin();
+            released = false;
+
+            // Shrinking right after enlarging must not lose the workers that are still starting (or leaving)
+            thread resizer([&]() {
+                while (dac.resize(nwork) == 0)
+                    this_thread::yield();
+
+                // Directly through the pool, that the computation must follow as well
+                pool.resize(1);
+                pool.resize(nwork);
+                released = true;
+            });
+
+            dac.compute({input.cbegin(), input.cend()}, res, pool);
+            resizer.join();
+            held_root = nullptr;
+
+            if (res.size() != input.size() || !std::is_sorted(res.begin(), res.end())) {
+                fprintf(stderr, "Error: array not sorted!!\n");
+                exit(-1);
+            }
+
+            if (threads.size() < 2) {
+                fprintf(stderr, "Error: the workers added have not executed any job!!\n");
+                exit(-1);
+            }
+
+            printf("%d,%d,%lu\n", nwork, slots, threads.size());
+        }
+    }
+
+    DAC<Operand, Result> dac(div, mergef, cf, sq);
+    Pool pool(max_proc);
+    Result res;
+
+    dac.follow_cpu_quota(true, chrono::milliseconds(10));
+    dac.compute({input.cbegin(), input.cend()}, res, pool);
+
+    if (res.size() != input.size() || !std::is_sorted(res.begin(), res.end())) {
+        fprintf(stderr, "Error: array not sorted!!\n");
+        exit(-1);
+    }
+
+    printf("CPU quota: %lu, workers: %lu\n", cpu_quota(), pool.size());
+
+    return 0;
+}
@@ -0,0 +1,379 @@
+/*
+
+ External Mergesort: sort a file of N integers that does not need to fit in memory, using the DAC pattern.
+
+ The recursion tree has a fixed height, so that every leaf is at the same depth. Each leaf sorts a chunk of (at most)
+ CUTOFF integers of the memory-mapped input file and writes it as a sorted run; each conquer does a FAN_IN-way merge
+ of the runs of its children, reading and writing BUFFER integers at a time with read-ahead and write-behind
+ performed asynchronously. Runs at even depths are stored in the output file, runs at odd depths in a temporary file
+ of the same size, so that the root always writes the sorted result in the output file. The memory used by a worker
+ is bounded by max(CUTOFF, 2*(FAN_IN + 1)*BUFFER) integers, regardless of N.
+
+*/
+#include <iostream>
+#include <functional>
+#include <vector>
+#include <queue>
+#include <future>
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "../includes/utils.h"
+#include <dac/dac.h>
+using namespace std;
+#define CUTOFF (1ul << 20)
+#define FAN_IN 8ul
+#define BUFFER (1ul << 16)
+
+
+// Operand (i.e. the Problem) and Results share the same format: a range of the file, at a given depth of the tree
+struct run {
+    size_t begin;
+    size_t end;
+    unsigned depth;
+};
+
+typedef struct run Operand;
+typedef struct run Result;
+
+// Files and parameters shared by all the tasks
+struct {
+    const int *input;    // memory-mapped input file
+    int fds[2];          // output file (even depths) and temporary file (odd depths)
+    unsigned height;     // depth of the leaves
+} sorting;
+
+
+void check(bool condition, const char *what)
+{
+    if (!condition) {
+        fprintf(stderr, "Error: %s (%s)\n", what, strerror(errno));
+        exit(-1);
+    }
+}
+
+void read_fully(int fd, int *buffer, size_t count, size_t offset)
+{
+    auto bytes = (char *) buffer;
+    size_t left = count*sizeof(int), pos = offset*sizeof(int);
+
+    while (left > 0) {
+        ssize_t n = pread(fd, bytes, left, pos);
+        check(n > 0, "cannot read run");
+        bytes += n;
+        pos += n;
+        left -= n;
+    }
+}
+
+void write_fully(int fd, const int *buffer, size_t count, size_t offset)
+{
+    auto bytes = (const char *) buffer;
+    size_t left = count*sizeof(int), pos = offset*sizeof(int);
+
+    while (left > 0) {
+        ssize_t n = pwrite(fd, bytes, left, pos);
+        check(n > 0, "cannot write run");
+        bytes += n;
+        pos += n;
+        left -= n;
+    }
+}
+
+
+/*
+ * Sequential reader of a sorted run. While the current buffer is consumed, the next one is read asynchronously.
+ */
+class RunReader {
+    int fd;
+    size_t next, end, pos;
+    vector<int> current, ahead;
+    future<void> pending;
+
+    void prefetch()
+    {
+        if (next == end)
+            return;
+
+        size_t count = min(BUFFER, end - next), offset = next;
+        ahead.resize(count);
+        pending = async(launch::async, [this, count, offset]() { read_fully(fd, ahead.data(), count, offset); });
+        next += count;
+    }
+
+public:
+    RunReader(int fd, size_t begin, size_t end) : fd(fd), next(begin), end(end), pos(0)
+    {
+        prefetch();
+        advance();
+    }
+
+    bool empty() const { return pos == current.size(); }
+    int head() const { return current[pos]; }
+
+    void advance()
+    {
+        if (++pos < current.size())
+            return;
+
+        current.clear();
+        pos = 0;
+
+        if (pending.valid()) {
+            pending.get();
+            swap(current, ahead);
+            prefetch();
+        }
+    }
+};
+
+
+/*
+ * Sequential writer of a sorted run. While a buffer is being filled, the previous one is written asynchronously.
+ */
+class RunWriter {
+    int fd;
+    size_t next;
+    vector<int> current, behind;
+    future<void> pending;
+
+public:
+    RunWriter(int fd, size_t begin) : fd(fd), next(begin)
+    {
+        current.reserve(BUFFER);
+        behind.reserve(BUFFER);
+    }
+
+    void push(int value)
+    {
+        current.push_back(value);
+
+        if (current.size() == BUFFER)
+            flush();
+    }
+
+    void flush()
+    {
+        if (pending.valid())
+            pending.get();
+
+        swap(current, behind);
+        current.clear();
+
+        size_t count = behind.size(), offset = next;
+        pending = async(launch::async, [this, count, offset]() { write_fully(fd, behind.data(), count, offset); });
+        next += count;
+    }
+
+    void close()
+    {
+        flush();
+        pending.get();
+    }
+};
+
+
+/*
+ * The divide splits the range in FAN_IN parts of (almost) the same size
+ */
+void divide(const Operand &op, std::vector<Operand> &subops)
+{
+    size_t size = op.end - op.begin;
+
+    for (size_t i = 0; i < FAN_IN; i++) {
+        Operand sub;
+        sub.begin = op.begin + size*i/FAN_IN;
+        sub.end = op.begin + size*(i + 1)/FAN_IN;
+        sub.depth = op.depth + 1;
+        subops.push_back(sub);
+    }
+}
+
+
+/*
+ * For the base case we copy the chunk from the mapped file, resort to std::sort, and write it as a run
+ */
+void seq(const Operand &op, Result &ret)
+{
+    vector<int> chunk(sorting.input + op.begin, sorting.input + op.end);
+    std::sort(chunk.begin(), chunk.end());
+    write_fully(sorting.fds[op.depth%2], chunk.data(), chunk.size(), op.begin);
+
+    // Release the pages of the chunk, we will not need them anymore
+    auto page = sysconf(_SC_PAGESIZE);
+    auto first = ((size_t) (sorting.input + op.begin))/page*page;
+    madvise((void *) first, (size_t) (sorting.input + op.end) - first, MADV_DONTNEED);
+
+    ret = op;
+}
+
+
+/*
+ * The Merge (Combine) function does a k-way merge of the runs of the children, writing them into a single run
+ */
+void mergeRuns(vector<Result> &ress, Result &ret)
+{
+    ret.begin = ress.front().begin;
+    ret.end = ress.back().end;
+    ret.depth = ress.front().depth - 1;
+
+    vector<RunReader> readers;
+    readers.reserve(ress.size());
+
+    for (auto &res: ress)
+        readers.emplace_back(sorting.fds[res.depth%2], res.begin, res.end);
+
+    using Head = pair<int, size_t>;
+    priority_queue<Head, vector<Head>, greater<Head>> heads;
+
+    for (size_t i = 0; i < readers.size(); i++)
+        if (!readers[i].empty())
+            heads.emplace(readers[i].head(), i);
+
+    RunWriter writer(sorting.fds[ret.depth%2], ret.begin);
+
+    while (!heads.empty()) {
+        auto i = heads.top().second;
+        writer.push(heads.top().first);
+        heads.pop();
+        readers[i].advance();
+
+        if (!readers[i].empty())
+            heads.emplace(readers[i].head(), i);
+    }
+
+    writer.close();
+}
+
+
+/*
+ * Base case condition
+ */
+bool cond(const Operand &op)
+{
+    return op.depth == sorting.height;
+}
+
+// Writes a random file of n integers, returning their sum
+long long generateRandomFile(const string &path, size_t n)
+{
+    int fd = open(path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    check(fd >= 0, "cannot create input file");
+
+    long long sum = 0;
+    vector<int> block;
+
+    for (size_t i = 0; i < n; i += block.size()) {
+        block.resize(min(BUFFER, n - i));
+
+        for (auto &x: block) {
+            x = rand();
+            sum += x;
+        }
+
+        write_fully(fd, block.data(), block.size(), i);
+    }
+
+    close(fd);
+    return sum;
+}
+
+//simple check, streaming the file
+bool isFileSorted(int fd, size_t n, long long sum)
+{
+    RunReader reader(fd, 0, n);
+    int last = 0;
+    size_t count = 0;
+
+    for (; !reader.empty(); reader.advance(), count++) {
+        if (count > 0 && reader.head() < last)
+            return false;
+
+        last = reader.head();
+        sum -= last;
+    }
+
+    return count == n && sum == 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 5) {
+        cerr << "Usage: " << argv[0] << " <num_elements> <min_proc> <max_proc> <num_trials> [<directory>]" << endl;
+        exit(-1);
+    }
+    const std::function<void(const Operand &, vector<Operand> &)> div(divide);
+    const std::function<void(const Operand &, Result &)> sq(seq);
+    const std::function<void(vector<Result> &, Result &)> mergef(mergeRuns);
+    const std::function<bool(const Operand &)> cf(cond);
+
+    size_t num_elem = atol(argv[1]);
+    int min_proc = atoi(argv[2]);
+    int max_proc = atoi(argv[3]);
+    int num_trials = atoi(argv[4]);
+    string dir = argc > 5 ? argv[5] : ".";
+
+    string in_path = dir + "/ext_input.bin", out_path = dir + "/ext_output.bin", tmp_path = dir + "/ext_tmp.bin";
+    long long sum = generateRandomFile(in_path, num_elem);
+
+    sorting.height = 0;
+
+    for (size_t leaf = num_elem; leaf > CUTOFF; leaf = (leaf + FAN_IN - 1)/FAN_IN)
+        sorting.height++;
+
+    printf("Workers,Time (ms)\n");
+
+    for (auto nwork = min_proc; nwork <= max_proc; nwork *= 2) {
+        for (auto trial = 0; trial < num_trials; trial++) {
+            int in_fd = open(in_path.c_str(), O_RDONLY);
+            check(in_fd >= 0, "cannot open input file");
+            sorting.input = (const int *) mmap(nullptr, max(num_elem, 1ul)*sizeof(int), PROT_READ, MAP_PRIVATE,
+                                               in_fd, 0);
+            check(sorting.input != MAP_FAILED, "cannot map input file");
+
+            sorting.fds[0] = open(out_path.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+            sorting.fds[1] = open(tmp_path.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+            check(sorting.fds[0] >= 0 && sorting.fds[1] >= 0, "cannot create output files");
+            check(ftruncate(sorting.fds[0], num_elem*sizeof(int)) == 0, "cannot resize output file");
+
+            //build the operand
+            Operand op;
+            op.begin = 0;
+            op.end = num_elem;
+            op.depth = 0;
+
+            Result res;
+            DAC<Operand, Result> dac(div, mergef, cf, sq);
+
+            long start_t = current_time_usecs();
+
+            //compute
+            dac.compute(op, res, nwork);
+
+            long end_t = current_time_usecs();
+
+            //Correctness check
+            if (!isFileSorted(sorting.fds[0], num_elem, sum)) {
+                fprintf(stderr, "Error: file is not sorted!!\n");
+                exit(-1);
+            }
+
+            printf("%d,%ld\n", nwork, end_t - start_t);
+
+            munmap((void *) sorting.input, max(num_elem, 1ul)*sizeof(int));
+            close(in_fd);
+            close(sorting.fds[0]);
+            close(sorting.fds[1]);
+        }
+    }
+
+    unlink(in_path.c_str());
+    unlink(out_path.c_str());
+    unlink(tmp_path.c_str());
+
+    return 0;
+}
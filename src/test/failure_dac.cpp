@@ -0,0 +1,207 @@
+/*
+
+ Failure propagation: inject exceptions in the DAC functions and check that compute rethrows them
+
+ The problem is the sum of the integers in a range, split in halves. An exception is thrown by the divide, the base case,
+ the conquer or the base test of the leftmost node at a given depth of the recursion tree: the computation must stop
+ (i.e., not hang) and rethrow the exception, and the same DAC instance must compute the correct result afterwards.
+ Every execution mode is tested (promises, output slots, memoization and streams), with the adaptive policy, which
+ calls the base test also to estimate the cost of the sub-problems.
+
+*/
+#include <iostream>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../includes/utils.h"
+#include <dac/dac.h>
+using namespace std;
+#define CUTOFF 64
+
+typedef pair<long, long> Operand;
+
+struct Result {
+    long lo, hi, sum;
+};
+
+enum Phase { divide_phase, base_phase, conquer_phase, test_phase };
+const char *phase_names[] = {"divide", "base", "conquer", "test"};
+const char *mode_names[] = {"promise", "slots", "memo", "stream"};
+
+long n;
+int fail_phase = -1;
+long fail_size = 0;
+
+
+/*
+ * Throws if the range is the one chosen for the failure
+ */
+void inject(Phase phase, long lo, long hi)
+{
+    if (phase == fail_phase && lo == 0 && hi - lo == fail_size)
+        throw runtime_error(phase_names[phase]);
+}
+
+
+/*
+ * The divide splits the range in halves
+ */
+void divide(const Operand &op, std::vector<Operand> &subops)
+{
+    inject(divide_phase, op.first, op.second);
+
+    long mid = op.first + (op.second - op.first)/2;
+    subops.push_back({op.first, mid});
+    subops.push_back({mid, op.second});
+}
+
+
+/*
+ * The base case sums the range sequentially
+ */
+void seq(const Operand &op, Result &ret)
+{
+    inject(base_phase, op.first, op.second);
+
+    ret = {op.first, op.second, 0};
+
+    for (auto i = op.first; i < op.second; i++)
+        ret.sum += i;
+}
+
+
+/*
+ * The Combine sums the results
+ */
+void sum(vector<Result> &ress, Result &ret)
+{
+    inject(conquer_phase, ress[0].lo, ress[1].hi);
+
+    ret = {ress[0].lo, ress[1].hi, ress[0].sum + ress[1].sum};
+}
+
+
+/*
+ * Base case condition
+ */
+bool cond(const Operand &op)
+{
+    inject(test_phase, op.first, op.second);
+
+    return op.second - op.first <= CUTOFF;
+}
+
+//simple check
+bool isCorrect(const Operand &op, const Result &res)
+{
+    return res.sum == (op.first + op.second - 1)*(op.second - op.first)/2;
+}
+
+// Runs the computation in the given mode, returns the name of the exception thrown (if any)
+string run(DAC<Operand, Result> &dac, int mode, int nwork, bool &correct)
+{
+    Operand op(0, n);
+    Result res;
+    correct = true;
+
+    try {
+        if (mode == 3) {
+            // The first item of the stream is the range that fails, the others are correct
+            long next = 0;
+
+            dac.compute_stream([&](Operand &item) {
+                if (next == 8)
+                    return false;
+
+                item = {next*n, (next + 1)*n};
+                next++;
+
+                return true;
+            }, [&](unsigned long index, Result &out) {
+                correct = correct && out.lo == (long) index*n && isCorrect({out.lo, out.hi}, out);
+            }, nwork, true, Scheduler::Policy::adaptive);
+        } else {
+            dac.compute(op, res, nwork, Scheduler::Policy::adaptive);
+            correct = isCorrect(op, res);
+        }
+    } catch (runtime_error &e) {
+        return e.what();
+    }
+
+    return "";
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 4) {
+        cerr << "Usage: " << argv[0] << " <n> <min_proc> <max_proc>" << endl;
+        exit(-1);
+    }
+    const std::function<void(const Operand &, vector<Operand> &)> div(divide);
+    const std::function<void(const Operand &, Result &)> sq(seq);
+    const std::function<void(vector<Result> &, Result &)> sumf(sum);
+    const std::function<bool(const Operand &)> cf(cond);
+
+    n = atol(argv[1]);
+    int min_proc = atoi(argv[2]);
+    int max_proc = atoi(argv[3]);
+
+    // Deepest level of the recursion tree
+    int depth = 0;
+
+    while ((n >> depth) > CUTOFF)
+        depth++;
+
+
+    printf("Workers,Mode,Phase,Depth,Time (ms)\n");
+
+    for (auto nwork = min_proc; nwork <= max_proc; nwork *= 2) {
+        for (auto mode = 0; mode < 4; mode++) {
+            DAC<Operand, Result> dac(div, sumf, cf, sq);
+
+            if (mode == 1)
+                dac.set_output_slots(true);
+            else if (mode == 2)
+                dac.set_memoization([](const Operand &op) { return hash<long>()(op.first*31 + op.second); });
+
+            for (auto phase = 0; phase < 4; phase++) {
+                for (auto d = 0; d <= depth; d++) {
+                    // The leaves are at the deepest level, the internal nodes above it (the base test is called on both)
+                    if (phase != test_phase && (phase == base_phase) != (d == depth))
+                        continue;
+
+                    bool correct;
+                    fail_phase = phase;
+                    fail_size = n >> d;
+
+                    long start_t = current_time_usecs();
+
+                    //compute
+                    string error = run(dac, mode, nwork, correct);
+
+                    long end_t = current_time_usecs();
+
+                    //Correctness check
+                    if (error != phase_names[phase]) {
+                        fprintf(stderr, "Error: exception not propagated (%s, %s, depth %d)!!\n",
+                                mode_names[mode], phase_names[phase], d);
+                        exit(-1);
+                    }
+
+                    // The same instance must still work
+                    fail_phase = -1;
+
+                    if (!run(dac, mode, nwork, correct).empty() || !correct) {
+                        fprintf(stderr, "Error: wrong result after a failure!!\n");
+                        exit(-1);
+                    }
+
+                    printf("%d,%s,%s,%d,%ld\n", nwork, mode_names[mode], phase_names[phase], d, end_t - start_t);
+                }
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,124 @@
+/*
+
+ Fibonacci: compute the N-th Fibonacci number with the DAC pattern, with and without memoization
+
+ The naive recursion fib(n) = fib(n-1) + fib(n-2) produces the same sub-problems in many different branches: without
+ memoization the recursion tree has O(phi^N) nodes, while with memoization every fib(k) is computed only once.
+
+*/
+#include <iostream>
+#include <functional>
+#include <vector>
+#include "../includes/utils.h"
+#include <dac/dac.h>
+using namespace std;
+#define CUTOFF 20
+
+typedef int Operand;
+typedef unsigned long long Result;
+
+
+/*
+ * The divide produces n-1 and n-2
+ */
+void divide(const Operand &op, std::vector<Operand> &subops)
+{
+    subops.push_back(op - 1);
+    subops.push_back(op - 2);
+}
+
+
+/*
+ * For the base case we resort to the (sequential) naive recursion
+ */
+Result fib(int n)
+{
+    return n < 2 ? n : fib(n - 1) + fib(n - 2);
+}
+
+void seq(const Operand &op, Result &ret)
+{
+    ret = fib(op);
+}
+
+
+/*
+ * The Combine sums the results
+ */
+void sum(vector<Result> &ress, Result &ret)
+{
+    ret = ress[0] + ress[1];
+}
+
+
+/*
+ * Base case condition
+ */
+bool cond(const Operand &op)
+{
+    return op <= CUTOFF;
+}
+
+//simple check
+bool isCorrect(int n, Result res)
+{
+    Result a = 0, b = 1;
+
+    for (int i = 0; i < n; i++) {
+        b = a + b;
+        a = b - a;
+    }
+
+    return a == res;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 5) {
+        cerr << "Usage: " << argv[0] << " <n> <min_proc> <max_proc> <num_trials>" << endl;
+        exit(-1);
+    }
+    const std::function<void(const Operand &, vector<Operand> &)> div(divide);
+    const std::function<void(const Operand &, Result &)> sq(seq);
+    const std::function<void(vector<Result> &, Result &)> sumf(sum);
+    const std::function<bool(const Operand &)> cf(cond);
+
+    int n = atoi(argv[1]);
+    int min_proc = atoi(argv[2]);
+    int max_proc = atoi(argv[3]);
+    int num_trials = atoi(argv[4]);
+
+
+    printf("Workers,Memoization,Time (ms)\n");
+
+    for (auto nwork = min_proc; nwork <= max_proc; nwork *= 2) {
+        for (auto memo = 0; memo < 2; memo++) {
+            for (auto trial = 0; trial < num_trials; trial++) {
+                Result res;
+                DAC<Operand, Result> dac(div, sumf, cf, sq);
+
+                if (memo)
+                    dac.set_memoization(std::hash<Operand>());
+                else
+                    dac.set_output_slots(true);
+
+                long start_t = current_time_usecs();
+
+                //compute
+                dac.compute(n, res, nwork);
+
+                long end_t = current_time_usecs();
+
+                //Correctness check
+                if (!isCorrect(n, res)) {
+                    fprintf(stderr, "Error: wrong result!!\n");
+                    exit(-1);
+                }
+
+                printf("%d,%d,%ld\n", nwork, memo, end_t - start_t);
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*
+
+ First touch: check that first_touch splits a range as a DAC computation with a binary divide and the same cut-off
+
+ A range is written with first_touch, recording the worker that has written every chunk (and in which order), and then
+ processed on the same pool by a DAC computation that halves it, recording the worker that has solved every base case.
+ The chunks must be exactly the base cases. With a single worker, they must also be visited in the same order (which
+ is not the case with parallel_for, that keeps the other half on the current worker). With more workers, the share of
+ the base cases solved by the worker that has written them is only reported, as it depends on the balancing.
+
+*/
+#include <iostream>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include "../includes/utils.h"
+#include <dac/dac.h>
+#include <dac/memory.h>
+using namespace std;
+#define CUTOFF 1000
+
+typedef pair<long, long> Operand;
+typedef long Result;
+
+// A chunk of the range, as written or solved
+struct Visit {
+    long end;
+    unsigned long worker;
+    long order;
+};
+
+vector<Visit> leaves;
+atomic_long next_leaf(0);
+
+// The ID of the worker running on the current thread (the bodies of first_touch and parallel_for do not receive it)
+thread_local unsigned long worker_id;
+
+
+/*
+ * The divide splits the range in halves
+ */
+void divide(const Operand &op, std::vector<Operand> &subops)
+{
+    long mid = op.first + (op.second - op.first)/2;
+    subops.push_back({op.first, mid});
+    subops.push_back({mid, op.second});
+}
+
+
+/*
+ * Base case condition
+ */
+bool cond(const Operand &op)
+{
+    return op.second - op.first <= CUTOFF;
+}
+
+
+/*
+ * The Combine does nothing (the base cases are only recorded)
+ */
+void none(vector<Result> &, Result &ret)
+{
+    ret = 0;
+}
+
+// Records the chunks visited, indexed by their beginning
+void record(vector<Visit> &visits, atomic_long &counter, long begin, long end, unsigned long worker)
+{
+    visits[begin] = {end, worker, counter++};
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 4) {
+        cerr << "Usage: " << argv[0] << " <n> <min_proc> <max_proc>" << endl;
+        exit(-1);
+    }
+
+    long n = atol(argv[1]);
+    int min_proc = atoi(argv[2]);
+    int max_proc = atoi(argv[3]);
+
+    printf("Workers,Chunks,Same worker (%%)\n");
+
+    for (auto nwork = min_proc; nwork <= max_proc; nwork *= 2) {
+        Pool pool(nwork);
+        vector<Visit> touched(n, {-1, 0, 0}), split(n, {-1, 0, 0});
+        atomic_long next_touched(0), next_split(0);
+
+        leaves.assign(n, {-1, 0, 0});
+        next_leaf = 0;
+
+        pool.run([](unsigned long id) { worker_id = id; });
+
+        first_touch(pool, 0l, n, [&](long begin, long end) {
+            record(touched, next_touched, begin, end, worker_id);
+        }, CUTOFF);
+
+        parallel_for(pool, 0l, n, [&](long begin, long end) {
+            record(split, next_split, begin, end, worker_id);
+        }, CUTOFF);
+
+        const std::function<void(const Operand &, vector<Operand> &)> div(divide);
+        const std::function<void(const Operand &, Result &)> sq([](const Operand &op, Result &ret) {
+            record(leaves, next_leaf, op.first, op.second, worker_id);
+            ret = 0;
+        });
+        const std::function<void(vector<Result> &, Result &)> nonef(none);
+        const std::function<bool(const Operand &)> cf(cond);
+
+        DAC<Operand, Result> dac(div, nonef, cf, sq);
+        Result res;
+
+        dac.compute({0, n}, res, pool);
+
+        //Correctness check
+        long chunks = 0, same = 0;
+        bool same_order = true, mirrored = false;
+
+        for (auto i = 0l; i < n; i++) {
+            if (touched[i].end != leaves[i].end) {
+                fprintf(stderr, "Error: the chunks are not the base cases!!\n");
+                exit(-1);
+            }
+
+            if (leaves[i].end < 0)
+                continue;
+
+            chunks++;
+            same += touched[i].worker == leaves[i].worker;
+            same_order = same_order && touched[i].order == leaves[i].order;
+            mirrored = mirrored || split[i].order != leaves[i].order;
+        }
+
+        if (nwork == 1 && (!same_order || (chunks > 1 && !mirrored))) {
+            fprintf(stderr, "Error: the chunks are not visited in the order of the base cases!!\n");
+            exit(-1);
+        }
+
+        printf("%d,%ld,%.1f\n", nwork, chunks, 100.*same/chunks);
+    }
+
+    return 0;
+}
@@ -28,11 +28,18 @@
  Mergesort: sort an array of N integer in parallel using the DAC pattern
   and C++11 semantics (iterator)
 
+ With huge_pages set to 1 (DAC only), the array is backed by huge pages,
+  and it is initialized in parallel by the workers that will sort it (first
+  touch). These workers are created once per parallelism degree, before the
+  array is initialized, hence their creation is not timed: otherwise (and in
+  the other variants) the threads are spawned within the timed region
+
 
 */
 #include <iostream>
 #include <functional>
 #include <vector>
+#include <memory>
 #include <algorithm>
 #include <cstring>
 #include "../includes/utils.h"
@@ -45,6 +52,8 @@ using namespace ff;
 #include "../includes/dac_tbb.hpp"
 #else
 #include <dac/dac.h>
+#include <dac/memory.h>
+#define USE_DAC 1
 #endif
 using namespace std;
 #define CUTOFF 2000
@@ -52,8 +61,8 @@ using namespace std;
 
 // Operand (i.e. the Problem) and Results share the same format
 struct ops{
-	vector<int>::iterator left;
-	vector<int>::iterator right;
+	int *left;
+	int *right;
 };
 
 typedef struct ops Operand;
@@ -66,7 +75,7 @@ typedef struct ops Result;
  */
 void divide(const Operand &op,std::vector<Operand> &subops)
 {
-	vector<int>::iterator mid=op.left+(op.right-op.left)/2;
+	int *mid=op.left+(op.right-op.left)/2;
 	Operand a;
 	a.left=op.left;
 	a.right=mid;
@@ -96,9 +105,9 @@ void seq(const Operand &op, Result &ret)
 void mergeMS(vector<Result>&ress, Result &ret)
 {
 	//compute what is needed: array pointer, mid, ...
-	vector<int>::iterator i=ress[0].left;
-	vector<int>::iterator mid=ress[0].right;
-	vector<int>::iterator j=mid;
+	int *i=ress[0].left;
+	int *mid=ress[0].right;
+	int *j=mid;
 	int size=ress[1].right-ress[0].left;
 	vector<int> tmp(size);
 
@@ -135,7 +144,7 @@ bool cond(const Operand &op)
 }
 
 //simple check
-bool isVectorSorted(vector<int> a, int n)
+bool isVectorSorted(int *a, int n)
 {
 	for(int i=1;i<n;i++)
 		if(a[i]<a[i-1])
@@ -147,7 +156,7 @@ int main(int argc, char *argv[])
 {
 	if(argc<5)
 	{
-		cerr << "Usage: " << argv[0] << " <num_elements> <min_proc> <max_proc> <num_trials>" << endl;
+		cerr << "Usage: " << argv[0] << " <num_elements> <min_proc> <max_proc> <num_trials> [huge_pages]" << endl;
 		exit(-1);
 	}
 	const std::function<void(const Operand&,vector<Operand>&)> div(divide);
@@ -159,22 +168,47 @@ int main(int argc, char *argv[])
     int min_proc=atoi(argv[2])  ;
     int max_proc=atoi(argv[3]);
     int num_trials=atoi(argv[4]);
+#if USE_DAC
+    int huge_pages=argc>5 ? atoi(argv[5]) : 0;
+#endif
 
 
     printf("Workers,Time (ms)\n");
 
 	for (auto nwork = min_proc; nwork <= max_proc; nwork *= 2) {
+#if USE_DAC
+	    //the same workers initialize and sort the array (only with huge pages)
+	    unique_ptr<Pool> pool(huge_pages ? new Pool(nwork) : nullptr);
+#endif
+
 	    for (auto trial = 0; trial < num_trials; trial++) {
             //generate a only_global array
             int *numbers=generateRandomArray(num_elem);
             //fill the vector
-            vector<int> v(numbers, numbers+num_elem ); // use some utility to avoid hardcoding the size here
+            vector<int> v;
+            int *data;
+#if USE_DAC
+            vector<int, HugePageAllocator<int>> hv;
+
+            if (huge_pages) {
+                //every leaf is copied by the worker that will likely sort it
+                hv.resize(num_elem);
+                data=hv.data();
+                first_touch(*pool, data, data+num_elem, [&](int *begin, int *end) {
+                    std::copy(numbers+(begin-data), numbers+(end-data), begin);
+                }, CUTOFF);
+            } else
+#endif
+            {
+                v.assign(numbers, numbers+num_elem); // use some utility to avoid hardcoding the size here
+                data=v.data();
+            }
 
             //build the operand
             Operand op;
 
-            op.left=v.begin();
-            op.right=v.end();
+            op.left=data;
+            op.right=data+num_elem;
 
             Result res;
 #if USE_FF
@@ -197,12 +231,15 @@ int main(int argc, char *argv[])
 #elif USE_TBB
             dac.compute();
 #else
-            dac.compute(op, res, nwork);
+            if (pool)
+                dac.compute(op, res, *pool);
+            else
+                dac.compute(op, res, nwork);
 #endif
             long end_t=current_time_usecs();
 
             //Correctness check
-            if(!isVectorSorted(v,num_elem))
+            if(!isVectorSorted(data,num_elem))
             {
                 fprintf(stderr,"Error: array is not sorted!!\n");
                 exit(-1);
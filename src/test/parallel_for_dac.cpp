@@ -0,0 +1,110 @@
+/*
+
+ Parallel for: check that every index of a range is visited exactly once
+
+ An array of counters is incremented by parallel_for, with several grains: 1, a grain that does not divide the range,
+ a grain larger than half the range, the whole range and more. Every counter must be exactly 1, and every chunk must be
+ non-empty and at most as large as the grain. Empty and reversed ranges must not call the body at all. Finally, the
+ body throws on the chunk of a given index: parallel_for must rethrow the exception, and the same pool must still work.
+
+*/
+#include <iostream>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "../includes/utils.h"
+#include <dac/parallel_for.h>
+using namespace std;
+
+long n;
+
+// Visits [0, n) with the given grain, returns false if an index is not visited exactly once or a chunk is too large
+bool visit(Pool &pool, size_t grain)
+{
+    unique_ptr<atomic_int[]> counters(new atomic_int[n]);
+    atomic_bool chunks_ok(true);
+
+    for (auto i = 0l; i < n; i++)
+        counters[i] = 0;
+
+    parallel_for(pool, 0l, n, [&](long begin, long end) {
+        if (begin >= end || (size_t) (end - begin) > max(grain, (size_t) 1))
+            chunks_ok = false;
+
+        for (auto i = begin; i < end; i++)
+            counters[i]++;
+    }, grain);
+
+    for (auto i = 0l; i < n; i++)
+        if (counters[i] != 1)
+            return false;
+
+    return chunks_ok;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 4) {
+        cerr << "Usage: " << argv[0] << " <n> <min_proc> <max_proc>" << endl;
+        exit(-1);
+    }
+
+    n = atol(argv[1]);
+    int min_proc = atoi(argv[2]);
+    int max_proc = atoi(argv[3]);
+
+    vector<size_t> grains = {0, 1, 7, (size_t) n/2 + 1, (size_t) n, (size_t) n + 5};
+
+    printf("Workers,Grain,Time (ms)\n");
+
+    for (auto nwork = min_proc; nwork <= max_proc; nwork *= 2) {
+        Pool pool(nwork);
+
+        for (auto grain: grains) {
+            long start_t = current_time_usecs();
+
+            bool correct = visit(pool, grain);
+
+            long end_t = current_time_usecs();
+
+            if (!correct) {
+                fprintf(stderr, "Error: wrong visit with grain %zu!!\n", grain);
+                exit(-1);
+            }
+
+            printf("%d,%zu,%ld\n", nwork, grain, end_t - start_t);
+        }
+
+        // Empty and reversed ranges
+        atomic_int calls(0);
+        auto count = [&](long, long) { calls++; };
+
+        parallel_for(pool, 5l, 5l, count);
+        parallel_for(pool, 7l, 3l, count);
+
+        if (calls != 0) {
+            fprintf(stderr, "Error: the body has been called on an empty range!!\n");
+            exit(-1);
+        }
+
+        // A failing body
+        bool rethrown = false;
+
+        try {
+            parallel_for(pool, 0l, n, [&](long begin, long end) {
+                if (begin <= n/2 && n/2 < end)
+                    throw runtime_error("body");
+            }, 16);
+        } catch (runtime_error &e) {
+            rethrown = string(e.what()) == "body";
+        }
+
+        if (!rethrown || !visit(pool, 16)) {
+            fprintf(stderr, "Error: exception not propagated, or pool not usable afterwards!!\n");
+            exit(-1);
+        }
+    }
+
+    return 0;
+}
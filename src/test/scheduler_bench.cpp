@@ -0,0 +1,61 @@
+/*
+
+ Scheduler benchmark: measure the overhead of scheduling fine-grained jobs
+
+ A loop of N (almost) empty iterations is run with parallel_for and a grain of 1, so that the range is bisected down to
+ single elements and the scheduler handles about 2N jobs. Since the jobs do no real work, the time is spent in the
+ scheduler itself: queue accesses, job counters, and the balancing test.
+
+*/
+#include <iostream>
+#include <atomic>
+#include <vector>
+#include "../includes/utils.h"
+#include <dac/parallel_for.h>
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+    if (argc < 5) {
+        cerr << "Usage: " << argv[0] << " <num_jobs> <min_proc> <max_proc> <num_trials>" << endl;
+        exit(-1);
+    }
+
+    long num_jobs = atol(argv[1]);
+    int min_proc = atoi(argv[2]);
+    int max_proc = atoi(argv[3]);
+    int num_trials = atoi(argv[4]);
+
+
+    printf("Workers,Time (ms)\n");
+
+    for (auto nwork = min_proc; nwork <= max_proc; nwork *= 2) {
+        Pool pool(nwork);
+
+        for (auto trial = 0; trial < num_trials; trial++) {
+            vector<char> visited(num_jobs, 0);
+
+            long start_t = current_time_usecs();
+
+            //compute
+            parallel_for(pool, 0l, num_jobs, [&](long begin, long end) {
+                for (auto i = begin; i < end; i++)
+                    visited[i] = 1;
+            });
+
+            long end_t = current_time_usecs();
+
+            //Correctness check
+            for (auto v: visited) {
+                if (!v) {
+                    fprintf(stderr, "Error: iteration skipped!!\n");
+                    exit(-1);
+                }
+            }
+
+            printf("%d,%ld\n", nwork, end_t - start_t);
+        }
+    }
+
+    return 0;
+}
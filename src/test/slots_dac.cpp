@@ -0,0 +1,162 @@
+/*
+
+ Output slots: compare the output slot mode with the promise mode on the same inputs
+
+ The problem is a hash of a range of integers over an irregular recursion tree: a range is divided in two or three
+ parts (depending on its bounds), or in no parts at all, and every conquer combines the results of its children in
+ order. Hence, the result depends both on the shape of the tree and on the order of the results. It is computed with
+ promises, with output slots, and with the conquer taking a Span (which implies the output slots), and compared with
+ the sequential recursion.
+
+*/
+#include <iostream>
+#include <functional>
+#include <vector>
+#include "../includes/utils.h"
+#include <dac/dac.h>
+using namespace std;
+#define CUTOFF 16
+
+typedef pair<long, long> Operand;
+typedef unsigned long Result;
+
+const char *mode_names[] = {"promise", "slots", "span"};
+
+
+/*
+ * The divide splits the range in three parts, in two parts, or in no parts
+ */
+void divide(const Operand &op, std::vector<Operand> &subops)
+{
+    long size = op.second - op.first;
+
+    if (op.first % 7 == 3)
+        return;
+
+    if (op.first % 3 == 0 && size >= 3) {
+        subops.push_back({op.first, op.first + size/3});
+        subops.push_back({op.first + size/3, op.first + 2*(size/3)});
+        subops.push_back({op.first + 2*(size/3), op.second});
+        return;
+    }
+
+    subops.push_back({op.first, op.first + size/2});
+    subops.push_back({op.first + size/2, op.second});
+}
+
+
+/*
+ * The base case hashes the range sequentially
+ */
+void seq(const Operand &op, Result &ret)
+{
+    ret = 7;
+
+    for (auto i = op.first; i < op.second; i++)
+        ret = ret*31 + i;
+}
+
+
+/*
+ * The Combine hashes the results in order (no results give a constant)
+ */
+void combine(Span<Result> ress, Result &ret)
+{
+    ret = 11 + ress.size();
+
+    for (auto r: ress)
+        ret = ret*131 + r;
+}
+
+void combine_vector(vector<Result> &ress, Result &ret)
+{
+    combine(Span<Result>(ress.data(), ress.size()), ret);
+}
+
+
+/*
+ * Base case condition
+ */
+bool cond(const Operand &op)
+{
+    return op.second - op.first <= CUTOFF;
+}
+
+// Sequential recursion, used as reference
+Result reference(const Operand &op)
+{
+    Result ret;
+
+    if (cond(op)) {
+        seq(op, ret);
+        return ret;
+    }
+
+    vector<Operand> subops;
+    divide(op, subops);
+
+    vector<Result> ress;
+
+    for (auto &subop: subops)
+        ress.push_back(reference(subop));
+
+    combine_vector(ress, ret);
+
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 4) {
+        cerr << "Usage: " << argv[0] << " <n> <min_proc> <max_proc>" << endl;
+        exit(-1);
+    }
+    const std::function<void(const Operand &, vector<Operand> &)> div(divide);
+    const std::function<void(const Operand &, Result &)> sq(seq);
+    const std::function<void(vector<Result> &, Result &)> combf(combine_vector);
+    const std::function<void(Span<Result>, Result &)> spanf(combine);
+    const std::function<bool(const Operand &)> cf(cond);
+
+    long n = atol(argv[1]);
+    int min_proc = atoi(argv[2]);
+    int max_proc = atoi(argv[3]);
+
+    // Some roots are divided in no parts at all
+    vector<Operand> inputs = {{0, n}, {1, n + 1}, {3, n + 3}, {10, 10 + CUTOFF}};
+
+    printf("Workers,Mode,Input,Time (ms)\n");
+
+    for (auto nwork = min_proc; nwork <= max_proc; nwork *= 2) {
+        for (auto mode = 0; mode < 3; mode++) {
+            DAC<Operand, Result> dac(div, combf, cf, sq);
+            DAC<Operand, Result> span_dac(div, spanf, cf, sq);
+
+            if (mode == 1)
+                dac.set_output_slots(true);
+
+            for (auto &op: inputs) {
+                Result res;
+                long start_t = current_time_usecs();
+
+                //compute
+                if (mode == 2)
+                    span_dac.compute(op, res, nwork);
+                else
+                    dac.compute(op, res, nwork);
+
+                long end_t = current_time_usecs();
+
+                //Correctness check
+                if (res != reference(op)) {
+                    fprintf(stderr, "Error: wrong result (%s, [%ld, %ld))!!\n", mode_names[mode], op.first,
+                            op.second);
+                    exit(-1);
+                }
+
+                printf("%d,%s,%ld,%ld\n", nwork, mode_names[mode], op.first, end_t - start_t);
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,141 @@
+/*
+
+ Stream: compute a stream of sums of ranges, and check the order of the results and the inputs held at the same time
+
+ Every input of the stream is a range of integers, summed by halving it. One input every four is much larger than the
+ others, so that the results are completed out of order. In ordered mode, the sink must receive the results in the
+ order of their inputs, in unordered mode every result exactly once; in both modes, the inputs retrieved by the source
+ whose result has not been passed to the sink yet must never be more than twice the workers.
+
+*/
+#include <iostream>
+#include <functional>
+#include <vector>
+#include <algorithm>
+#include "../includes/utils.h"
+#include <dac/dac.h>
+using namespace std;
+#define CUTOFF 256
+
+typedef pair<long, long> Operand;
+typedef long Result;
+
+const char *mode_names[] = {"unordered", "ordered"};
+
+
+/*
+ * The divide splits the range in halves
+ */
+void divide(const Operand &op, std::vector<Operand> &subops)
+{
+    long mid = op.first + (op.second - op.first)/2;
+    subops.push_back({op.first, mid});
+    subops.push_back({mid, op.second});
+}
+
+
+/*
+ * The base case sums the range sequentially
+ */
+void seq(const Operand &op, Result &ret)
+{
+    ret = 0;
+
+    for (auto i = op.first; i < op.second; i++)
+        ret += i;
+}
+
+
+/*
+ * The Combine sums the results
+ */
+void sum(vector<Result> &ress, Result &ret)
+{
+    ret = ress[0] + ress[1];
+}
+
+
+/*
+ * Base case condition
+ */
+bool cond(const Operand &op)
+{
+    return op.second - op.first <= CUTOFF;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 5) {
+        cerr << "Usage: " << argv[0] << " <n> <items> <min_proc> <max_proc>" << endl;
+        exit(-1);
+    }
+    const std::function<void(const Operand &, vector<Operand> &)> div(divide);
+    const std::function<void(const Operand &, Result &)> sq(seq);
+    const std::function<void(vector<Result> &, Result &)> sumf(sum);
+    const std::function<bool(const Operand &)> cf(cond);
+
+    long n = atol(argv[1]);
+    long items = atol(argv[2]);
+    int min_proc = atoi(argv[3]);
+    int max_proc = atoi(argv[4]);
+
+    auto input = [n](long index) {
+        return Operand(index, index + (index % 4 == 0 ? n : n/16 + 1));
+    };
+
+    printf("Workers,Mode,Max held,Time (ms)\n");
+
+    for (auto nwork = min_proc; nwork <= max_proc; nwork *= 2) {
+        for (auto ordered = 0; ordered < 2; ordered++) {
+            DAC<Operand, Result> dac(div, sumf, cf, sq);
+            vector<int> seen(items, 0);
+            long next = 0, sunk = 0, held = 0, max_held = 0;
+            bool correct = true;
+
+            long start_t = current_time_usecs();
+
+            //compute
+            dac.compute_stream([&](Operand &op) {
+                if (next == items)
+                    return false;
+
+                op = input(next++);
+                max_held = max(max_held, ++held);
+
+                return true;
+            }, [&](unsigned long index, Result &res) {
+                auto op = input(index);
+
+                correct = correct && index < (unsigned long) items
+                          && res == (op.first + op.second - 1)*(op.second - op.first)/2
+                          && (!ordered || (long) index == sunk);
+
+                if (index < (unsigned long) items)
+                    seen[index]++;
+
+                held--;
+                sunk++;
+            }, nwork, ordered);
+
+            long end_t = current_time_usecs();
+
+            //Correctness check
+            correct = correct && all_of(seen.begin(), seen.end(), [](int count) { return count == 1; });
+
+            if (!correct) {
+                fprintf(stderr, "Error: wrong results (%s)!!\n", mode_names[ordered]);
+                exit(-1);
+            }
+
+            if (max_held > 2*nwork) {
+                fprintf(stderr, "Error: %ld inputs held at the same time, with %d workers (%s)!!\n", max_held,
+                        nwork, mode_names[ordered]);
+                exit(-1);
+            }
+
+            printf("%d,%s,%ld,%ld\n", nwork, mode_names[ordered], max_held, end_t - start_t);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,167 @@
+/*
+
+ Task graph: run a random DAG and check that every node runs exactly once, after all its predecessors
+
+ Every node of a random DAG (plus a diamond and a node depending on every other one, to have a large fan-in) counts the
+ predecessors that have already completed when it starts: they must be all of them. After the run, every node must
+ have run exactly once. Then a node throws an exception: the run must rethrow it without running the successors of
+ that node, and the graph must run correctly again afterwards. Finally, a graph with a cycle must be rejected.
+
+*/
+#include <iostream>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../includes/utils.h"
+#include <dac/task_graph.h>
+using namespace std;
+#define MAX_PREDECESSORS 4
+
+long n;
+unique_ptr<atomic_int[]> runs;
+unique_ptr<atomic_bool[]> done;
+vector<vector<long>> predecessors;
+atomic_bool ordered;
+long fail_node = -1;
+
+// Body of every node
+void visit(long node)
+{
+    long completed = 0;
+
+    for (auto pred: predecessors[node])
+        completed += done[pred];
+
+    if (completed != (long) predecessors[node].size())
+        ordered = false;
+
+    if (node == fail_node)
+        throw runtime_error("node");
+
+    runs[node]++;
+    done[node] = true;
+}
+
+// Runs the graph, returns the name of the exception thrown (if any)
+string run(TaskGraph &graph, int nwork)
+{
+    for (auto i = 0l; i < n; i++) {
+        runs[i] = 0;
+        done[i] = false;
+    }
+
+    ordered = true;
+
+    try {
+        graph.run(nwork);
+    } catch (runtime_error &e) {
+        return e.what();
+    }
+
+    return "";
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 4) {
+        cerr << "Usage: " << argv[0] << " <n> <min_proc> <max_proc>" << endl;
+        exit(-1);
+    }
+
+    long random_nodes = max(atol(argv[1]), 1l);
+    int min_proc = atoi(argv[2]);
+    int max_proc = atoi(argv[3]);
+
+    // The random DAG (edges only from lower to higher IDs), then a diamond, then a node after all the others
+    TaskGraph graph;
+    mt19937 rng(42);
+
+    n = random_nodes + 5;
+    runs.reset(new atomic_int[n]);
+    done.reset(new atomic_bool[n]);
+    predecessors.resize(n);
+
+    for (auto i = 0l; i < n; i++)
+        graph.add_node([i](unsigned long) { visit(i); });
+
+    auto add_dependency = [&](long before, long after) {
+        graph.add_dependency(before, after);
+        predecessors[after].push_back(before);
+    };
+
+    for (auto i = 1l; i < random_nodes; i++) {
+        auto count = rng() % (MAX_PREDECESSORS + 1);
+
+        for (auto k = 0ul; k < count; k++)
+            add_dependency(rng() % i, i);
+    }
+
+    long top = random_nodes;
+    add_dependency(top, top + 1);
+    add_dependency(top, top + 2);
+    add_dependency(top + 1, top + 3);
+    add_dependency(top + 2, top + 3);
+
+    for (auto i = 0l; i < n - 1; i++)
+        add_dependency(i, n - 1);
+
+    printf("Workers,Time (ms)\n");
+
+    for (auto nwork = min_proc; nwork <= max_proc; nwork *= 2) {
+        fail_node = -1;
+
+        long start_t = current_time_usecs();
+
+        //compute
+        string error = run(graph, nwork);
+
+        long end_t = current_time_usecs();
+
+        //Correctness check
+        bool once = true;
+
+        for (auto i = 0l; i < n; i++)
+            once = once && runs[i] == 1;
+
+        if (!error.empty() || !once || !ordered) {
+            fprintf(stderr, "Error: wrong execution (%s)!!\n", !once ? "not once" : "not ordered");
+            exit(-1);
+        }
+
+        // A failing node: its successors (e.g., the last node) must not run
+        fail_node = top + 1;
+
+        if (run(graph, nwork) != "node" || runs[top + 3] != 0 || runs[n - 1] != 0) {
+            fprintf(stderr, "Error: exception not propagated!!\n");
+            exit(-1);
+        }
+
+        fail_node = -1;
+
+        if (!run(graph, nwork).empty() || runs[n - 1] != 1) {
+            fprintf(stderr, "Error: wrong execution after a failure!!\n");
+            exit(-1);
+        }
+
+        printf("%d,%ld\n", nwork, end_t - start_t);
+    }
+
+    // A cycle
+    TaskGraph cycle;
+    auto a = cycle.add_node([](unsigned long) {});
+    auto b = cycle.add_node([](unsigned long) {});
+    cycle.add_dependency(a, b);
+    cycle.add_dependency(b, a);
+
+    try {
+        cycle.run(min_proc);
+        fprintf(stderr, "Error: cycle not detected!!\n");
+        exit(-1);
+    } catch (logic_error &) {
+    }
+
+    return 0;
+}
@@ -0,0 +1,168 @@
+/*
+
+ Trace: record the scheduling decisions of a mergesort, replay them, and simulate the recorded job tree
+
+ The array is sorted once recording the decisions of the scheduler, and once more (on the same input) replaying them:
+ the replay must take exactly the same decisions. The same trace is then replayed while sorting a shorter and a longer
+ array: the replay diverges from the trace, and the sort must complete anyway. Then the recorded job tree is simulated
+ offline with different numbers of workers and balancing policies, without running the sort again.
+
+*/
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <functional>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include "../includes/utils.h"
+#include <dac/dac.h>
+using namespace std;
+#define CUTOFF 2000
+
+struct ops {
+    vector<int>::iterator left;
+    vector<int>::iterator right;
+};
+
+typedef struct ops Operand;
+typedef struct ops Result;
+
+
+/*
+ * The divide simply 'split' the array in two
+ */
+void divide(const Operand &op, std::vector<Operand> &subops)
+{
+    vector<int>::iterator mid = op.left + (op.right - op.left)/2;
+    subops.push_back({op.left, mid});
+    subops.push_back({mid, op.right});
+}
+
+
+/*
+ * For the base case we resort to std::sort
+ */
+void seq(const Operand &op, Result &ret)
+{
+    ret = op;
+    std::sort(ret.left, ret.right);
+}
+
+
+/*
+ * The Combine merges the two sorted halves
+ */
+void mergeMS(vector<Result> &ress, Result &ret)
+{
+    std::inplace_merge(ress[0].left, ress[0].right, ress[1].right);
+    ret = {ress[0].left, ress[1].right};
+}
+
+
+/*
+ * Base case condition
+ */
+bool cond(const Operand &op)
+{
+    return op.right - op.left <= CUTOFF;
+}
+
+// Sorts a copy of the input, returns the elapsed time
+long sort(DAC<Operand, Result> &dac, const vector<int> &input, int nwork)
+{
+    vector<int> v(input);
+    Operand op = {v.begin(), v.end()};
+    Result res;
+
+    long start_t = current_time_usecs();
+    dac.compute(op, res, nwork);
+    long end_t = current_time_usecs();
+
+    if (!std::is_sorted(v.begin(), v.end())) {
+        fprintf(stderr, "Error: array not sorted!!\n");
+        exit(-1);
+    }
+
+    return end_t - start_t;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 4) {
+        cerr << "Usage: " << argv[0] << " <num_elements> <min_proc> <max_proc> [trace_file]" << endl;
+        exit(-1);
+    }
+    const std::function<void(const Operand &, vector<Operand> &)> div(divide);
+    const std::function<void(const Operand &, Result &)> sq(seq);
+    const std::function<void(vector<Result> &, Result &)> mergef(mergeMS);
+    const std::function<bool(const Operand &)> cf(cond);
+
+    int num_elem = atoi(argv[1]);
+    int min_proc = atoi(argv[2]);
+    int max_proc = atoi(argv[3]);
+
+    int *data = generateRandomArray(num_elem);
+    vector<int> input(data, data + num_elem);
+    delete[] data;
+
+    // Inputs that do not match the recorded trace
+    vector<int> shorter(input.begin(), input.begin() + num_elem/2), longer(input);
+    longer.insert(longer.end(), input.begin(), input.end());
+
+
+    printf("Workers,Simulated workers,Policy,Time (us)\n");
+
+    for (auto nwork = min_proc; nwork <= max_proc; nwork *= 2) {
+        DAC<Operand, Result> dac(div, mergef, cf, sq);
+        dac.set_output_slots(true);
+        Trace recorded, replayed, loaded;
+
+        dac.record(recorded);
+        printf("%d,-,record,%ld\n", nwork, sort(dac, input, nwork));
+
+        // The trace goes through its binary format
+        stringstream buffer;
+        recorded.save(buffer);
+        loaded.load(buffer);
+
+        if (argc > 4) {
+            ofstream file(argv[4], ios::binary);
+            recorded.save(file);
+        }
+
+        dac.stop_tracing();
+        dac.replay(loaded);
+        dac.record(replayed);
+        printf("%d,-,replay,%ld\n", nwork, sort(dac, input, nwork));
+
+        //Correctness check
+        if (!replayed.same_decisions(recorded) || replayed.jobs() != recorded.jobs()) {
+            fprintf(stderr, "Error: the replay diverged!!\n");
+            exit(-1);
+        }
+
+        // A diverging replay must not hang (the arrays are checked by sort)
+        for (auto mismatched: {&shorter, &longer}) {
+            dac.record(replayed);
+            printf("%d,-,mismatched replay,%ld\n", nwork, sort(dac, *mismatched, nwork));
+
+            if (replayed.jobs() == recorded.jobs()) {
+                fprintf(stderr, "Error: the trace matches a different input!!\n");
+                exit(-1);
+            }
+        }
+
+        dac.stop_tracing();
+
+        // What-if analysis on the recorded tree
+        for (unsigned long sim = 1; sim <= 4ul*max_proc; sim *= 2) {
+            float best = sim >= 2 ? sim/(sim - 1.f) : numeric_limits<float>::max();
+
+            printf("%d,%lu,best,%.0f\n", nwork, sim, loaded.simulate(sim, best).makespan/1000.);
+            printf("%d,%lu,only_global,%.0f\n", nwork, sim, loaded.simulate(sim, -1.f).makespan/1000.);
+        }
+    }
+
+    return 0;
+}